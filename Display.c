@@ -17,18 +17,24 @@
 #include "timer.h"
 #include "interrupts.h"
 #include "gpio_interrupt.h"
+#include "Display.h"
+#include "hstimer.h"
+#include "irq_stats.h"
+#include "evtrace.h"
+#include "gpio_port.h"
+#include "assert.h"
+#include <stddef.h>
 
 // the following code is adapted from https://github.com/avishorp/TM1637/blob/master/TM1637Display.cpp 
 // ported from avishorp@gmail.com's rduino implementation
 
 // data sheet for tm1637 chip that was referenced: https://www.makerguides.com/wp-content/uploads/2019/08/TM1637-Datasheet.pdf
 
-#define TM1637_I2C_COMM1    0x40
-#define TM1637_I2C_COMM2    0xC0
-#define TM1637_I2C_COMM3    0x80
-
 #define SEG_DP  0b10000000
 
+static void tx_register(DisplayConfig *Display);
+static void tx_update_period(void);
+
 const uint8_t digitToSegment[] = {
   0b00111111,    // 0
   0b00000110,    // 1
@@ -51,21 +57,19 @@ const uint8_t digitToSegment[] = {
   0b00111111     // D
   };
 
-typedef struct {
-    gpio_id_t pinClk;       // Clock pin
-    gpio_id_t pinDIO;       // Data pin
-    unsigned int bitDelay;  // Bit delay in microseconds
-    uint8_t brightness; // brightness
-} DisplayConfig;
-
-void set_brightness(DisplayConfig *Display, uint8_t brightness, bool on);
-
 void display_init(DisplayConfig *Display, gpio_id_t Clk, gpio_id_t DIO, unsigned int bitDelay) {
     // Save pin numbers and bitDelay to Display struct
 	Display->pinClk = Clk;
 	Display->pinDIO = DIO;
-	Display->bitDelay = bitDelay;
+	Display->bitDelay = (bitDelay == DISPLAY_BITDELAY_AUTO) ? DISPLAY_MAX_BITDELAY : bitDelay;
     // a common default for bitdelay would be 100 microseconds
+    Display->tx_head = Display->tx_tail = 0;
+    Display->tx_phase = 0;
+    Display->nack_count = 0;
+    Display->tx_nacked = false;
+    Display->tx_retries = 0;
+    Display->tx_failed = false;
+    tx_register(Display);
 
 	// Clock and data pins are initialized to output mode and set to high
     // this leaves it in an idle state
@@ -74,7 +78,57 @@ void display_init(DisplayConfig *Display, gpio_id_t Clk, gpio_id_t DIO, unsigned
 	gpio_write(Clk, 1);
 	gpio_write(DIO, 1);
 
+    if (bitDelay == DISPLAY_BITDELAY_AUTO) {
+        display_calibrate(Display);
+    }
+    tx_update_period();
+
     set_brightness(Display, 7, true);
+
+    // blank all four digits so the shadow copy starts out matching the chip
+    const uint8_t blank[4] = {0, 0, 0, 0};
+    display_invalidate(Display);
+    set_segments(Display, blank, 4, 0, false);
+}
+
+void display_invalidate(DisplayConfig *Display) {
+    Display->shadow_valid = false;
+    Display->shadow_brightness = 0xff; // not a valid display control value
+}
+
+#define PROBE_FRAMES 8     // frames that must all be acknowledged for a delay to pass
+#define MARGIN_STEPS 2     // steps back up from the fastest passing delay
+
+// Sends a harmless data command PROBE_FRAMES times, true if the chip acked them all
+static bool probe(DisplayConfig *Display) {
+    for (int i = 0; i < PROBE_FRAMES; i++) {
+        start(Display);
+        bool ack = write_byte(Display, TM1637_I2C_COMM1 | TM1637_FIXED_ADDR);
+        stop(Display);
+        if (!ack) return false;
+    }
+    return true;
+}
+
+unsigned int display_calibrate(DisplayConfig *Display) {
+    unsigned int passed[MARGIN_STEPS + 1]; // the last few delays that passed, newest last
+    int npassed = 0;
+
+    // each step is 20% faster than the last
+    for (unsigned int delay = DISPLAY_MAX_BITDELAY; delay >= DISPLAY_MIN_BITDELAY; delay = delay * 4 / 5) {
+        Display->bitDelay = delay;
+        if (!probe(Display)) break;
+        if (npassed == MARGIN_STEPS + 1) {
+            for (int i = 0; i < MARGIN_STEPS; i++) passed[i] = passed[i + 1];
+            npassed--;
+        }
+        passed[npassed++] = delay;
+    }
+
+    // fall back to the slowest delay if the display never answered
+    Display->bitDelay = (npassed == 0) ? DISPLAY_MAX_BITDELAY : passed[0];
+    tx_update_period();
+    return Display->bitDelay;
 }
 
 void bitDelay(DisplayConfig *Display) {
@@ -150,53 +204,300 @@ void set_brightness(DisplayConfig *Display, uint8_t brightness, bool on) {
     }
 }
 
-void set_segments(DisplayConfig *Display, const uint8_t segments[], uint8_t length, uint8_t pos, bool clock_mode) {
-    start(Display); // signal start of communication
-    write_byte(Display, TM1637_I2C_COMM1);
-    stop(Display);
+// All display traffic goes through per-display frame queues. A frame is what goes
+// between one start and stop: a command byte, optionally followed by one data byte.
+// tx_tick advances every display with a queued frame by one bus phase, merging their
+// pin changes, and is run either by a timer handler (display_tx_init) or in a loop
+// with a bit delay between ticks.
+#define PHASES_PER_BYTE 18 // 8 bits of two phases each, then two for the ack
 
-    start(Display);
-    write_byte(Display, TM1637_I2C_COMM2 + (pos & 0x03));
+enum { DIO_KEEP, DIO_LOW, DIO_HIGH, DIO_RELEASE };
 
-    // write data for each segment, each digit has one byte of information
-    for (uint8_t k = 0; k < length; k++) {
-        if (clock_mode) {
-            write_byte(Display, (segments[k] | 0b10000000));
+// pin changes for one bus phase, applied in field order
+typedef struct {
+    bool clk_low;   // clock low before touching data
+    uint8_t dio;
+    bool clk_high;
+    bool ack;       // pulse the clock and sample the chip's ack
+    bool done;      // last phase of the frame
+} tx_action_t;
+
+static struct {
+    DisplayConfig *displays[DISPLAY_MAX];
+    int ndisplays;
+    unsigned int period_us;  // longest bitDelay of all displays, one tick per bit delay
+    volatile bool busy;      // timer is running
+    bool enabled;            // display_tx_init has been called
+    hstimer_id_t timer;
+} tx;
+
+// Works out the pin changes for one bus phase of a frame. The sequence is the same as
+// start, write_byte and stop.
+static tx_action_t tx_phase(const uint8_t *frame, unsigned int phase) {
+    tx_action_t act = {false, DIO_KEEP, false, false, false};
+    unsigned int len = frame[0];
+
+    if (phase == 0) { // start
+        act.dio = DIO_HIGH;
+        act.clk_high = true;
+    }
+    else if (phase == 1) {
+        act.dio = DIO_LOW;
+    }
+    else if (phase - 2 < len * PHASES_PER_BYTE) {
+        uint8_t byte = frame[1 + (phase - 2) / PHASES_PER_BYTE];
+        unsigned int step = (phase - 2) % PHASES_PER_BYTE;
+
+        if (step < 16 && (step & 1) == 0) {
+            act.clk_low = true;
+            act.dio = ((byte >> (step / 2)) & 0x01) ? DIO_RELEASE : DIO_LOW; // release for a 1
+        }
+        else if (step < 16) {
+            act.clk_high = true;
+        }
+        else if (step == 16) { // wait for the acknowledgment
+            act.clk_low = true;
+            act.dio = DIO_RELEASE;
+        }
+        else {
+            act.ack = true;
+        }
+    }
+    else {
+        unsigned int step = phase - 2 - len * PHASES_PER_BYTE;
+        if (step == 0) { // stop
+            act.clk_low = true;
+            act.dio = DIO_LOW;
+        }
+        else if (step == 1) {
+            act.clk_high = true;
         }
         else {
-            write_byte(Display, segments[k]);
+            act.dio = DIO_HIGH;
+            act.done = true;
         }
     }
+    return act;
+}
 
-	stop(Display);
+#define TX_MAX_RETRIES 3
 
-	start(Display);
-    // turn the display on with brightness setting
-	write_byte(Display, TM1637_I2C_COMM3 + (Display->brightness & 0x0f));
-	stop(Display);
+static void restart_tx_timer(void) {
+    hstimer_disable(tx.timer);
+    hstimer_init(tx.timer, tx.period_us);
+    hstimer_enable(tx.timer);
 }
 
-void display_num(DisplayConfig *Display, int num) {
-    uint8_t segments[4] = {0, 0, 0, 0};
+// Called when a frame was not acknowledged: doubles the display's bit delay (up to
+// DISPLAY_MAX_BITDELAY) and slows the transmitter to match before the frame is resent.
+static void tx_back_off(DisplayConfig *Display) {
+    Display->tx_retries++;
+    Display->bitDelay *= 2;
+    if (Display->bitDelay > DISPLAY_MAX_BITDELAY) Display->bitDelay = DISPLAY_MAX_BITDELAY;
+    if (Display->bitDelay > tx.period_us) {
+        tx.period_us = Display->bitDelay;
+        if (tx.busy) restart_tx_timer();
+    }
+}
+
+// Advances every display that has a queued frame by one bus phase. Returns true if any
+// display still has frames left afterwards.
+static bool tx_tick(void) {
+    gpio_batch_t clk_low, dio, clk_high;
+    DisplayConfig *acking[DISPLAY_MAX];
+    int nacking = 0;
+    bool pending = false;
+
+    gpio_batch_clear(&clk_low);
+    gpio_batch_clear(&dio);
+    gpio_batch_clear(&clk_high);
+
+    for (int i = 0; i < tx.ndisplays; i++) {
+        DisplayConfig *Display = tx.displays[i];
+        if (Display->tx_head == Display->tx_tail) continue;
+
+        const uint8_t *frame = Display->tx_frames[Display->tx_head % DISPLAY_TX_QUEUE_LEN];
+        tx_action_t act = tx_phase(frame, Display->tx_phase++);
+
+        if (act.clk_low) gpio_batch_write(&clk_low, Display->pinClk, 0);
+        if (act.dio == DIO_RELEASE) {
+            gpio_batch_set_function(&dio, Display->pinDIO, GPIO_FN_INPUT);
+        }
+        else if (act.dio != DIO_KEEP) {
+            gpio_batch_write(&dio, Display->pinDIO, act.dio == DIO_HIGH);
+            gpio_batch_set_function(&dio, Display->pinDIO, GPIO_FN_OUTPUT);
+        }
+        if (act.clk_high || act.ack) gpio_batch_write(&clk_high, Display->pinClk, 1);
+        if (act.ack) acking[nacking++] = Display;
+
+        if (act.done) {
+            Display->tx_phase = 0;
+            if (Display->tx_nacked && Display->tx_retries < TX_MAX_RETRIES) {
+                tx_back_off(Display); // resend the same frame, slower
+            }
+            else {
+                if (Display->tx_nacked) Display->tx_failed = true; // give up on this frame
+                Display->tx_head++;
+                Display->tx_retries = 0;
+            }
+            Display->tx_nacked = false;
+        }
+        if (Display->tx_head != Display->tx_tail) pending = true;
+    }
+
+    gpio_batch_apply(&clk_low);
+    gpio_batch_apply(&dio);
+    gpio_batch_apply(&clk_high);
+
+    if (nacking > 0) {
+        // device pulls DIO low for ACK while the clock is high
+        gpio_batch_clear(&clk_low);
+        for (int i = 0; i < nacking; i++) {
+            if (gpio_port_read(acking[i]->pinDIO)) {
+                acking[i]->nack_count++;
+                acking[i]->tx_nacked = true;
+            }
+            gpio_batch_write(&clk_low, acking[i]->pinClk, 0);
+        }
+        gpio_batch_apply(&clk_low);
+    }
+    return pending;
+}
+
+static void handle_tx_timer(void *aux_data) {
+    hstimer_interrupt_clear(tx.timer);
+    if (!tx_tick()) {
+        hstimer_disable(tx.timer);
+        tx.busy = false;
+    }
+}
+
+// Gets queued frames moving. With the transmitter running this only starts the timer
+// if it is idle, otherwise the frames are clocked out here before returning.
+static void tx_kick(void) {
+    if (!tx.enabled) {
+        while (tx_tick()) {
+            timer_delay_us(tx.period_us);
+        }
+        return;
+    }
+    if (!tx.busy) {
+        tx.busy = true;
+        restart_tx_timer();
+    }
+}
+
+static void tx_register(DisplayConfig *Display) {
+    for (int i = 0; i < tx.ndisplays; i++) {
+        if (tx.displays[i] == Display) return;
+    }
+    if (tx.ndisplays == DISPLAY_MAX) error("Too many displays\n");
+    tx.displays[tx.ndisplays++] = Display;
+}
+
+static void tx_update_period(void) {
+    tx.period_us = 0;
+    for (int i = 0; i < tx.ndisplays; i++) {
+        if (tx.displays[i]->bitDelay > tx.period_us) tx.period_us = tx.displays[i]->bitDelay;
+    }
+}
+
+void display_tx_init(hstimer_id_t timer) {
+    tx.timer = timer;
+    tx.busy = false;
+    interrupt_source_t source = (timer == HSTIMER0) ? INTERRUPT_SOURCE_HSTIMER0 : INTERRUPT_SOURCE_HSTIMER1;
+    irq_stats_register_handler(source, handle_tx_timer, NULL, "display tx");
+    interrupts_enable_source(source);
+    tx.enabled = true;
+}
+
+bool display_tx_busy(void) {
+    return tx.busy;
+}
+
+// Queues one frame for a display. If its queue is full the frames already in it are
+// sent first (or, with the transmitter running, waited on).
+static void queue_frame(DisplayConfig *Display, const uint8_t *bytes, uint8_t len) {
+    while (Display->tx_tail - Display->tx_head == DISPLAY_TX_QUEUE_LEN) {
+        tx_kick();
+    }
+    uint8_t *frame = Display->tx_frames[Display->tx_tail % DISPLAY_TX_QUEUE_LEN];
+    frame[0] = len;
+    for (uint8_t i = 0; i < len; i++) {
+        frame[1 + i] = bytes[i];
+    }
+    evtrace_record(EVT_DISPLAY_FRAME, len, Display->pinClk, frame[1] | (len > 1 ? frame[2] << 8 : 0));
+    Display->tx_tail++;
+}
+
+// Only the digits that differ from the shadow copy are queued, each as its own short
+// fixed-address frame, and the display control frame is skipped when the brightness
+// has not changed. Repeating the same digits costs no bus traffic at all.
+static void queue_segments(DisplayConfig *Display, const uint8_t segments[], uint8_t length, uint8_t pos, bool clock_mode) {
+    if (Display->tx_failed) { // a dropped frame left the chip out of step with shadow
+        Display->tx_failed = false;
+        display_invalidate(Display);
+    }
+    if (!Display->shadow_valid) {
+        uint8_t data_cmd = TM1637_I2C_COMM1 | TM1637_FIXED_ADDR;
+        queue_frame(Display, &data_cmd, 1);
+    }
+
+    // write data for each changed digit, each digit has one byte of information
+    for (uint8_t k = 0; k < length; k++) {
+        uint8_t digit = (pos + k) & 0x03;
+        uint8_t byte = clock_mode ? (segments[k] | 0b10000000) : segments[k];
+
+        if (!Display->shadow_valid || Display->shadow[digit] != byte) {
+            uint8_t digit_frame[2] = {TM1637_I2C_COMM2 + digit, byte};
+            queue_frame(Display, digit_frame, 2);
+            Display->shadow[digit] = byte;
+        }
+    }
+    Display->shadow_valid = true;
+
+    if (Display->shadow_brightness != Display->brightness) {
+        // turn the display on with brightness setting
+        uint8_t control = TM1637_I2C_COMM3 + (Display->brightness & 0x0f);
+        queue_frame(Display, &control, 1);
+        Display->shadow_brightness = Display->brightness;
+    }
+}
+
+void set_segments(DisplayConfig *Display, const uint8_t segments[], uint8_t length, uint8_t pos, bool clock_mode) {
+    queue_segments(Display, segments, length, pos, clock_mode);
+    tx_kick();
+}
+
+void set_segments_many(DisplayConfig *displays[], const uint8_t segments[][4], int n, bool clock_mode) {
+    for (int i = 0; i < n; i++) {
+        queue_segments(displays[i], segments[i], 4, 0, clock_mode);
+    }
+    tx_kick();
+}
+
+// Fills segments with num right-aligned, returns false if num cannot be shown
+static bool num_to_segments(uint8_t segments[4], int num) {
+    for (int i = 0; i < 4; i++) {
+        segments[i] = 0;
+    }
 
     if (num >= 9999) { // maximum possible number to display
         segments[0] = digitToSegment[9];
         segments[1] = digitToSegment[9];
         segments[2] = digitToSegment[9];
         segments[3] = digitToSegment[9];
-        set_segments(Display, segments, 4, 0, false);
-        return;
+        return true;
     }
 
     else if (num < 0) {
-        return;
+        return false;
     }
     
     else {
         if (num == 0) { // case for 0
             segments[3] = digitToSegment[0];
-            set_segments(Display, segments, 4, 0, false);
-            return;
+            return true;
         }
 
         int num_copy = num;
@@ -212,10 +513,27 @@ void display_num(DisplayConfig *Display, int num) {
             segments[i] = digitToSegment[digit];
             num /= 10;
         }
+        return true;
+    }
+}
+
+void display_num(DisplayConfig *Display, int num) {
+    uint8_t segments[4];
 
+    if (num_to_segments(segments, num)) {
         set_segments(Display, segments, 4, 0, false);
+    }
+}
+
+void display_num_many(DisplayConfig *displays[], const int nums[], int n) {
+    uint8_t segments[4];
 
+    for (int i = 0; i < n; i++) {
+        if (num_to_segments(segments, nums[i])) {
+            queue_segments(displays[i], segments, 4, 0, false);
+        }
     }
+    tx_kick();
 }
 
 void convert_to_clock(uint8_t *clock_digits, int num_secs) {
@@ -239,20 +557,72 @@ void display_countdown(DisplayConfig *Display, int mins, int secs) {
     set_segments(Display, segments, 4, 0, true);
 }
 
-//Takes in a number of mins and seconds and initiates a clock countdown from that number
-void start_countdown(DisplayConfig *Display, int mins, int secs) {
+void countdown_init(Countdown *cd, DisplayConfig *Display, int mins, int secs) {
     int initial_duration = (mins * 60) + secs;
-    
+
     if (initial_duration > 5999) initial_duration = 5999;
-    if (initial_duration < 1) return;
-    int start_ticks = timer_get_ticks();
-    int duration = initial_duration;
-    uint8_t clock_digits[4];
-    while (duration > 0) {
-        int time_elapsed = ((timer_get_ticks() - start_ticks) / 24) / (1000*1000);
-        duration = initial_duration - time_elapsed;
-        convert_to_clock(clock_digits, duration);
-        set_segments(Display, clock_digits, 4, 0, true);
+    if (initial_duration < 0) initial_duration = 0;
+    cd->display = Display;
+    cd->duration_ticks = systime_ms_to_ticks(initial_duration * 1000);
+    cd->secs_shown = -1;
+    cd->running = false;
+    cd->final_ten_fired = false;
+    cd->on_final_ten = NULL;
+    cd->on_expire = NULL;
+    cd->aux_data = NULL;
+}
+
+void countdown_set_callbacks(Countdown *cd, countdown_fn_t on_final_ten, countdown_fn_t on_expire, void *aux_data) {
+    cd->on_final_ten = on_final_ten;
+    cd->on_expire = on_expire;
+    cd->aux_data = aux_data;
+}
+
+void countdown_start(Countdown *cd) {
+    cd->start_ticks = systime_now();
+    cd->running = true;
+    countdown_update(cd); // draw the starting time right away
+}
+
+long countdown_remaining_ms(const Countdown *cd) {
+    if (!cd->running) return 0;
+    systime_t elapsed = systime_elapsed(cd->start_ticks);
+    if (elapsed >= cd->duration_ticks) return 0;
+    return systime_ticks_to_ms(cd->duration_ticks - elapsed);
+}
+
+bool countdown_update(Countdown *cd) {
+    if (!cd->running) return false;
+
+    long remaining_ms = countdown_remaining_ms(cd);
+    int secs = (remaining_ms + 999) / 1000; // round up so 0:00 only shows once time is out
+
+    if (secs != cd->secs_shown) {
+        uint8_t clock_digits[4];
+        cd->secs_shown = secs;
+        convert_to_clock(clock_digits, secs);
+        set_segments(cd->display, clock_digits, 4, 0, true);
     }
-    
-}
\ No newline at end of file
+
+    if (!cd->final_ten_fired && secs <= 10 && secs > 0) {
+        cd->final_ten_fired = true;
+        if (cd->on_final_ten) cd->on_final_ten(cd->aux_data);
+    }
+
+    if (remaining_ms == 0) {
+        cd->running = false;
+        if (cd->on_expire) cd->on_expire(cd->aux_data);
+    }
+    return cd->running;
+}
+
+//Takes in a number of mins and seconds and runs a clock countdown from that number,
+//returning once it reaches 0:00
+void start_countdown(DisplayConfig *Display, int mins, int secs) {
+    Countdown cd;
+
+    if ((mins * 60) + secs < 1) return;
+    countdown_init(&cd, Display, mins, secs);
+    countdown_start(&cd);
+    while (countdown_update(&cd)) {}
+}
@@ -2,6 +2,8 @@
 #define _DISPLAY_H
 
 #include "gpio.h"
+#include "hstimer.h"
+#include "systime.h"
 #include <stdint.h>
 
 #define TM1637_I2C_COMM1    0x40 // Command to set data
@@ -10,14 +12,38 @@
 
 extern const uint8_t digitToSegment[];
 
+#define TM1637_FIXED_ADDR   0x04 // Data command flag, write to one address instead of auto-incrementing
+
+#define DISPLAY_BITDELAY_AUTO 0 // pass as bitDelay to display_init to calibrate it
+#define DISPLAY_MAX_BITDELAY 100 // slowest bit delay, used when a display does not respond
+#define DISPLAY_MIN_BITDELAY 5   // fastest bit delay calibration will try
+#define DISPLAY_MAX 8           // displays that can be initialized at once
+#define DISPLAY_TX_QUEUE_LEN 8  // frames queued per display, must be a power of two
+
 typedef struct {
     gpio_id_t pinClk;       // Clock pin
     gpio_id_t pinDIO;       // Data pin
     unsigned int bitDelay;  // Bit delay in microseconds
+    uint8_t brightness;     // brightness
+    uint8_t shadow[4];      // segments last sent to each digit
+    uint8_t shadow_brightness; // display control last sent to the chip
+    bool shadow_valid;      // false until the chip is known to match shadow
+    uint8_t tx_frames[DISPLAY_TX_QUEUE_LEN][3]; // frames waiting to be sent: length, then up to 2 bytes
+    volatile unsigned int tx_head, tx_tail;     // head is advanced by the transmitter, tail by set_segments
+    unsigned int tx_phase;  // bus phase within the frame at tx_head
+    unsigned int nack_count; // bytes the chip did not acknowledge
+    bool tx_nacked;         // a byte of the frame being sent was not acknowledged
+    uint8_t tx_retries;     // times the frame being sent has been resent
+    volatile bool tx_failed; // a frame was dropped, shadow no longer matches the chip
 } DisplayConfig;
 
+// bitDelay of DISPLAY_BITDELAY_AUTO probes the display for the fastest reliable delay
 void display_init(DisplayConfig *Display, gpio_id_t Clk, gpio_id_t DIO, unsigned int bitDelay);
 
+// Steps the bit delay down while the chip acknowledges every probe frame and then backs off
+// for margin. Returns the new delay. Call before display_tx_init.
+unsigned int display_calibrate(DisplayConfig *Display);
+
 void bitDelay( DisplayConfig *Display);
 
 void start(DisplayConfig *Display);
@@ -30,10 +56,56 @@ void set_brightness(DisplayConfig *Display, uint8_t brightness, bool on);
 
 void set_segments(DisplayConfig *Display, const uint8_t segments[], uint8_t length, uint8_t pos, bool clock_mode);
 
+// Sends segments to several displays at once. Their clock and data edges share the same
+// bit slots and pins on the same port change in a single register write, so updating
+// all of them takes as long as updating the slowest one.
+void set_segments_many(DisplayConfig *displays[], const uint8_t segments[][4], int n, bool clock_mode);
+
+// Moves all display traffic to a background transmitter clocked by the given timer,
+// one bus phase per tick. After this, set_segments and everything built on it only queue
+// frames and return within microseconds. Interrupts must be enabled for frames to go out.
+void display_tx_init(hstimer_id_t timer);
+
+// true while queued frames are still being transmitted
+bool display_tx_busy(void);
+
+// forces the next set_segments to resend every digit and the brightness
+void display_invalidate(DisplayConfig *Display);
+
 void display_num(DisplayConfig *Display, int num);
 
+void display_num_many(DisplayConfig *displays[], const int nums[], int n);
+
 void display_countdown(DisplayConfig *Display, int mins, int secs);
 
 void start_countdown(DisplayConfig *Display, int mins, int secs);
 
+typedef void (*countdown_fn_t)(void *aux_data);
+
+// A countdown clock that runs alongside the rest of the program. countdown_update is
+// called from the main loop (or a periodic timer handler) and only redraws the display
+// when the shown second changes.
+typedef struct {
+    DisplayConfig *display;
+    systime_t start_ticks;
+    systime_t duration_ticks;
+    int secs_shown;             // second currently on the display, -1 before the first draw
+    bool running;
+    bool final_ten_fired;
+    countdown_fn_t on_final_ten; // called once when 10 seconds remain
+    countdown_fn_t on_expire;    // called once when the clock reaches 0:00
+    void *aux_data;             // passed to both callbacks
+} Countdown;
+
+void countdown_init(Countdown *cd, DisplayConfig *Display, int mins, int secs);
+
+void countdown_set_callbacks(Countdown *cd, countdown_fn_t on_final_ten, countdown_fn_t on_expire, void *aux_data);
+
+void countdown_start(Countdown *cd);
+
+// advances the clock, returns true while it is still running
+bool countdown_update(Countdown *cd);
+
+long countdown_remaining_ms(const Countdown *cd);
+
 #endif
\ No newline at end of file
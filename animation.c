@@ -0,0 +1,206 @@
+/* File: animation.c
+ * -------------
+ * Renders layered LED effects into per-strip framebuffers at a fixed frame rate and sends
+ * both strips together through show_strips. Frames are run by a periodic scheduler timer,
+ * a late frame is skipped rather than bunched up, and a frame identical to the one already
+ * on the strips is not resent.
+ */
+
+#include "animation.h"
+#include "systime.h"
+#include "scheduler.h"
+#include "evtrace.h"
+#include "strings.h"
+
+#define COMET_TAIL 6
+#define SCORE_FLASH_MS 150
+#define SCORE_FLASHES 2
+
+typedef struct {
+    animation_effect_t effect;
+    led_t color;
+    systime_t start_ticks;
+    systime_t period_ticks;
+    systime_t duration_ticks; // 0 runs forever
+} layer_t;
+
+static struct {
+    led_strip *strip2;
+    int nleds;
+    scheduler_timer_t frame_timer;
+    layer_t layers[ANIMATION_STRIPS][ANIMATION_LAYERS];
+    led_t framebuffers[ANIMATION_STRIPS][DOTSTAR_MAX_LEDS];
+    bool shown; // framebuffers have been sent at least once
+} anim;
+
+static void frame(void *aux_data) {
+    animation_update();
+}
+
+void animation_init(led_strip *strip2, int nleds, int fps) {
+    if (nleds > DOTSTAR_MAX_LEDS) nleds = DOTSTAR_MAX_LEDS;
+    memset(&anim, 0, sizeof(anim));
+    anim.strip2 = strip2;
+    anim.nleds = nleds;
+    scheduler_timer_start(&anim.frame_timer, 0, 1000 / fps, frame, NULL);
+}
+
+void animation_set(int strip, animation_layer_t layer, animation_effect_t effect, led_t color,
+                   int period_ms, int duration_ms) {
+    layer_t *l = &anim.layers[strip][layer];
+    l->effect = effect;
+    l->color = color;
+    l->start_ticks = systime_now();
+    l->period_ticks = systime_ms_to_ticks(period_ms > 0 ? period_ms : 1);
+    l->duration_ticks = systime_ms_to_ticks(duration_ms);
+}
+
+void animation_score_flash(int strip, led_t color) {
+    animation_set(strip, ANIMATION_LAYER_FLASH, ANIM_FLASH, color,
+                  2 * SCORE_FLASH_MS, SCORE_FLASHES * 2 * SCORE_FLASH_MS);
+}
+
+void animation_countdown_bar(int strip, led_t color, int duration_ms) {
+    animation_set(strip, ANIMATION_LAYER_OVERLAY, ANIM_COUNTDOWN_BAR, color, 0, duration_ms);
+}
+
+// color with each channel scaled by level/256, brightness bits unchanged
+static led_t scale(led_t color, unsigned int level) {
+    color.red = color.red * level >> 8;
+    color.green = color.green * level >> 8;
+    color.blue = color.blue * level >> 8;
+    return color;
+}
+
+static bool same_led(led_t a, led_t b) {
+    return a.bright == b.bright && a.red == b.red && a.green == b.green && a.blue == b.blue;
+}
+
+// What a layer looks like in the current frame, worked out once per layer so the per-pixel
+// loop needs no division
+typedef struct {
+    const layer_t *layer;
+    bool visible;       // false where the whole layer is transparent this frame
+    led_t color;        // of its lit leds
+    unsigned long next; // chase: next lit led, the lit ones are 3 apart
+    long head;          // comet: position of the head
+    int lit;            // countdown bar: leds still lit
+} layer_frame_t;
+
+static void frame_layer(layer_frame_t *f, const layer_t *l, systime_t elapsed) {
+    const int n = anim.nleds;
+    unsigned long step = elapsed / l->period_ticks;
+    unsigned long phase = elapsed - step * l->period_ticks;
+
+    f->layer = l;
+    f->visible = true;
+    f->color = l->color;
+    switch (l->effect) {
+    case ANIM_CHASE: // lit where (i + step) % 3 == 0
+        f->next = (3 - step % 3) % 3;
+        break;
+    case ANIM_PULSE: { // triangle wave, 0 to 256 and back
+        unsigned long half = l->period_ticks / 2 ? l->period_ticks / 2 : 1;
+        unsigned long rise = phase < half ? phase : l->period_ticks - phase;
+        f->color = scale(l->color, rise * 256 / half);
+        break;
+    }
+    case ANIM_COMET:
+        f->head = step % (n + COMET_TAIL);
+        break;
+    case ANIM_FLASH:
+        f->visible = phase < l->period_ticks / 2;
+        break;
+    case ANIM_COUNTDOWN_BAR: {
+        if (l->duration_ticks == 0) {
+            f->visible = false;
+            break;
+        }
+        unsigned long remaining = l->duration_ticks - elapsed;
+        // rounds up so the last led stays lit until time runs out
+        f->lit = (n * (unsigned long long)remaining + l->duration_ticks - 1) / l->duration_ticks;
+        break;
+    }
+    case ANIM_SOLID:
+        break;
+    case ANIM_NONE:
+    default:
+        f->visible = false;
+        break;
+    }
+}
+
+// Pixel i of a layer, returns false where the layer is transparent. Pixels come in order.
+static bool render_pixel(layer_frame_t *f, int i, led_t *out) {
+    if (!f->visible) return false;
+
+    switch (f->layer->effect) {
+    case ANIM_CHASE:
+        while (f->next < (unsigned long)i) f->next += 3; // the layer may have been covered since
+        *out = (f->next == (unsigned long)i) ? f->color : COLOR(0, 0, 0);
+        return true;
+    case ANIM_COMET: {
+        long dist = f->head - i; // how far the head is past this led
+        *out = (dist >= 0 && dist < COMET_TAIL)
+             ? scale(f->color, 256 * (COMET_TAIL - dist) / COMET_TAIL) : COLOR(0, 0, 0);
+        return true;
+    }
+    case ANIM_COUNTDOWN_BAR:
+        *out = f->color;
+        return i < f->lit;
+    default: // solid, pulse, flash
+        *out = f->color;
+        return true;
+    }
+}
+
+// Composites all layers of a strip into its framebuffer, returns true if any pixel changed
+static bool render_strip(int s, systime_t now) {
+    layer_frame_t frames[ANIMATION_LAYERS];
+    bool changed = false;
+
+    for (int k = 0; k < ANIMATION_LAYERS; k++) {
+        layer_t *l = &anim.layers[s][k];
+        systime_t elapsed = now - l->start_ticks;
+        if (l->duration_ticks && elapsed >= l->duration_ticks) {
+            l->effect = ANIM_NONE; // finished, drops out of the stack
+            l->duration_ticks = 0;
+        }
+        frame_layer(&frames[k], l, elapsed);
+    }
+
+    for (int i = 0; i < anim.nleds; i++) {
+        led_t px = COLOR(0, 0, 0);
+        for (int k = ANIMATION_LAYERS - 1; k >= 0; k--) { // topmost lit layer wins
+            if (render_pixel(&frames[k], i, &px)) break;
+        }
+        if (!same_led(anim.framebuffers[s][i], px)) {
+            anim.framebuffers[s][i] = px;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool animation_update(void) {
+    systime_t now = systime_now();
+    bool changed = false;
+    for (int s = 0; s < ANIMATION_STRIPS; s++) {
+        changed |= render_strip(s, now);
+    }
+    if (!changed && anim.shown) return false;
+
+    show_strips(anim.strip2, anim.framebuffers[0], anim.framebuffers[1], anim.nleds);
+    evtrace_record(EVT_LED_FRAME, 0, 0, anim.nleds);
+    anim.shown = true;
+    return true;
+}
+
+bool animation_busy(void) {
+    for (int s = 0; s < ANIMATION_STRIPS; s++) {
+        for (int k = 0; k < ANIMATION_LAYERS; k++) {
+            if (anim.layers[s][k].duration_ticks) return true;
+        }
+    }
+    return false;
+}
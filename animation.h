@@ -0,0 +1,53 @@
+/* File: animation.h
+ * -------------
+ * Frame-based effects for the two LED strips. Each strip has a stack of layers that are
+ * rendered into its framebuffer and composited bottom to top, the topmost layer that lights
+ * a pixel wins. Frames are rendered by a scheduler timer (scheduler.h) at the frame rate,
+ * so the game keeps running between frames.
+ */
+#ifndef _ANIMATION_H
+#define _ANIMATION_H
+
+#include <stdbool.h>
+#include "dotstar.h"
+
+#define ANIMATION_STRIPS 2 // strip 0 is on hardware SPI1, strip 1 is bit-banged
+
+typedef enum {
+    ANIMATION_LAYER_BASE,    // team color, anything it leaves dark is off
+    ANIMATION_LAYER_OVERLAY, // countdown bar
+    ANIMATION_LAYER_FLASH,   // score flash
+    ANIMATION_LAYERS
+} animation_layer_t;
+
+typedef enum {
+    ANIM_NONE,          // transparent
+    ANIM_SOLID,
+    ANIM_CHASE,         // every third led lit, marching one led per period
+    ANIM_PULSE,         // whole strip fades up and back down once per period
+    ANIM_COMET,         // bright head with a fading tail, moving one led per period
+    ANIM_FLASH,         // lit for the first half of each period, transparent for the rest
+    ANIM_COUNTDOWN_BAR, // lit length shrinks from the full strip to nothing over the duration
+} animation_effect_t;
+
+// Starts the frame timer, needs scheduler_init first
+void animation_init(led_strip *strip2, int nleds, int fps);
+
+// Replaces one layer of a strip. duration_ms of 0 runs until replaced, otherwise the
+// layer turns transparent once it has run that long.
+void animation_set(int strip, animation_layer_t layer, animation_effect_t effect, led_t color,
+                   int period_ms, int duration_ms);
+
+// Two quick flashes of color on the flash layer, over whatever is below
+void animation_score_flash(int strip, led_t color);
+
+void animation_countdown_bar(int strip, led_t color, int duration_ms);
+
+// Renders a frame right away and sends it unless it matches the one on the strips, returns
+// true if it was sent. The frame timer calls this at the frame rate.
+bool animation_update(void);
+
+// true while any layer with a duration is still running
+bool animation_busy(void);
+
+#endif
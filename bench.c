@@ -0,0 +1,92 @@
+/* File: bench.c
+ * -------------
+ * Measures LED strip throughput. Build and run with `make bench`, results are
+ * printed over the uart. Strip 2 is bit-banged on the pins used by myprogram.c
+ * at several clock rates, strip 1 goes over hardware SPI1 at several bit rates, both
+ * with DMA and with the interrupt-driven spi_transfer_start.
+ */
+
+#include "uart.h"
+#include "printf.h"
+#include "systime.h"
+#include "gpio.h"
+#include "interrupts.h"
+#include "spi.h"
+#include "dotstar.h"
+
+#define FRAMES_PER_RUN 50
+
+static const int strip_lengths[] = {10, 60, 144};
+static const long strip2_clocks[] = {1000000, 2000000, 4000000, 8000000};
+static const long strip1_rates[] = {2000000, 12000000, 24000000};
+
+static led_t pixels[DOTSTAR_MAX_LEDS];
+
+static void report(const char *label, int nleds, systime_t ticks) {
+    unsigned long bytes = (unsigned long)FRAMES_PER_RUN * DOTSTAR_FRAME_BYTES(nleds);
+    printf("%s, %d leds: %ld bytes/s, %ld frames/s\n", label, nleds,
+           (long)(bytes * SYSTIME_TICKS_PER_SEC / ticks), (long)(FRAMES_PER_RUN * SYSTIME_TICKS_PER_SEC / ticks));
+}
+
+static void bench_strip2(led_strip *strip, long hz, int nleds) {
+    char label[32];
+    spi2_set_clock(strip, hz);
+    systime_t start = systime_now();
+    for (int i = 0; i < FRAMES_PER_RUN; i++) {
+        show_strip(strip, pixels, nleds, true);
+    }
+    snprintf(label, sizeof(label), "strip 2 @ %ld kHz", hz / 1000);
+    report(label, nleds, systime_now() - start);
+}
+
+static void bench_strip1(long rate, int nleds) {
+    char label[32];
+    spi_init(SPI_MODE_0, rate);
+    dotstar_init(nleds);
+    systime_t start = systime_now();
+    for (int i = 0; i < FRAMES_PER_RUN; i++) {
+        show_strip(NULL, pixels, nleds, false);
+    }
+    while (dotstar_busy()) {}
+    snprintf(label, sizeof(label), "strip 1 DMA @ %ld kHz", spi_get_rate() / 1000);
+    report(label, nleds, systime_now() - start);
+
+    static DOTSTAR_BUFFER_STORAGE(storage, DOTSTAR_MAX_LEDS);
+    dotstar_buffer_t buf;
+    dotstar_buffer_init(&buf, storage, nleds);
+    for (int i = 0; i < nleds; i++) {
+        buf.pixels[i] = pixels[i];
+    }
+    start = systime_now();
+    for (int i = 0; i < FRAMES_PER_RUN; i++) {
+        spi_transfer_start(buf.frame, buf.len, NULL, NULL);
+    }
+    while (spi_busy()) {}
+    snprintf(label, sizeof(label), "strip 1 irq @ %ld kHz", spi_get_rate() / 1000);
+    report(label, nleds, systime_now() - start);
+}
+
+void main(void) {
+    gpio_init();
+    timer_init();
+    uart_init();
+    interrupts_init();
+    spi_init(SPI_MODE_0, SPI2_DEFAULT_CLOCK_HZ);
+    interrupts_global_enable(); // for spi_transfer_start
+
+    led_strip strip2;
+    spi2_init(&strip2, GPIO_PC1, GPIO_PD15);
+    for (int i = 0; i < DOTSTAR_MAX_LEDS; i++) {
+        pixels[i] = COLOR(i, 255 - i, 0x40);
+    }
+
+    printf("\nLED strip throughput, %d frames per run\n", FRAMES_PER_RUN);
+    for (int n = 0; n < sizeof(strip_lengths) / sizeof(*strip_lengths); n++) {
+        for (int c = 0; c < sizeof(strip2_clocks) / sizeof(*strip2_clocks); c++) {
+            bench_strip2(&strip2, strip2_clocks[c], strip_lengths[n]);
+        }
+        for (int r = 0; r < sizeof(strip1_rates) / sizeof(*strip1_rates); r++) {
+            bench_strip1(strip1_rates[r], strip_lengths[n]);
+        }
+    }
+}
@@ -12,6 +12,10 @@
 #include "gpio_interrupt.h"
 #include "Display.h"
 #include "timer.h"
+#include "button.h"
+
+#define LONG_PRESS_MS 1500 // holding the button this long selects the mode
+#define RELEASE_IGNORE_MS 250
 
 void button_init(gpio_id_t button) {
     gpio_set_input(button);
@@ -22,27 +26,44 @@ bool button_is_pressed(gpio_id_t button) {
     return gpio_read(button) == 0;
 }
 
+void button_mode_select_start(mode_select_t *ms, DisplayConfig *display, gpio_id_t button, int num_modes) {
+    ms->display = display;
+    ms->button = button;
+    ms->num_modes = num_modes;
+    ms->mode = 1;
+    ms->pressed = false;
+    ms->ignore_until = systime_now();
+    display_num(display, ms->mode);
+}
+
+int button_mode_select_poll(mode_select_t *ms) {
+    if (!systime_expired(ms->ignore_until)) return 0;
+
+    if (button_is_pressed(ms->button)) {
+        if (!ms->pressed) {
+            ms->pressed = true;
+            ms->long_press = systime_deadline_ms(LONG_PRESS_MS);
+        }
+        return systime_expired(ms->long_press) ? ms->mode : 0;
+    }
+    if (ms->pressed) { // released before the long press, on to the next mode
+        ms->pressed = false;
+        ms->mode = (ms->mode % ms->num_modes) + 1;
+        display_num(ms->display, ms->mode);
+        ms->ignore_until = systime_deadline_ms(RELEASE_IGNORE_MS);
+    }
+    return 0;
+}
+
 /* The buttom_mode_select function takes in a display, button, and number of modes and begins the 
 cycling process, waiting for the user to press the button and select which game mode to play. A single press
 will cycle to the next mode, and a long press will return the mode the user selected.
 */
 int button_mode_select(DisplayConfig *display, gpio_id_t button, int num_modes) {
-    int mode = 1;
-    display_num(display, mode);
-
-    while (1) {
-        if (button_is_pressed(button)) {
-            unsigned int press_begin = timer_get_ticks();
-
-            while (button_is_pressed(button)) {
-                unsigned int press_time = timer_get_ticks() - press_begin;
-                if (press_time >= 36000000) {  // if button pressed for 1.5 seconds (24000000 / 1 sec)
-                    return mode;
-                }
-            }
-            mode = (mode % num_modes) + 1;
-            display_num(display, mode);
-            timer_delay_ms(250);
-        }
-    }
-}
\ No newline at end of file
+    mode_select_t ms;
+    int mode;
+
+    button_mode_select_start(&ms, display, button, num_modes);
+    while ((mode = button_mode_select_poll(&ms)) == 0) {}
+    return mode;
+}
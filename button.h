@@ -7,6 +7,18 @@
 #include "gpio_interrupt.h"
 #include "Display.h"
 #include "timer.h"
+#include "systime.h"
+
+// Mode selection that is polled instead of waited on, see button_mode_select
+typedef struct {
+    DisplayConfig *display;
+    gpio_id_t button;
+    int num_modes;
+    int mode;
+    bool pressed;
+    systime_t long_press; // deadline for the current press to select the mode
+    systime_t ignore_until; // bounce after a release
+} mode_select_t;
 
 void button_init(gpio_id_t button);
 
@@ -14,4 +26,9 @@ bool button_is_pressed(gpio_id_t button);
 
 int button_mode_select(DisplayConfig *display, gpio_id_t button, int num_modes);
 
+void button_mode_select_start(mode_select_t *ms, DisplayConfig *display, gpio_id_t button, int num_modes);
+
+// Returns the selected mode once the button has been held, 0 until then
+int button_mode_select_poll(mode_select_t *ms);
+
 #endif
\ No newline at end of file
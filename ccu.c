@@ -290,6 +290,7 @@ static struct debug_info info_table[] = {
     { INFO_BGR(CCU_HDMI_BGR_REG),     {PARENT_AHB0} },
     { INFO_BGR(CCU_TCONTV_BGR_REG),   {PARENT_AHB0} },
     { INFO_BGR(CCU_DMA_BGR_REG),      {PARENT_AHB0} },
+    { INFO_BGR(CCU_MBUS_MAT_CLK_GATING_REG), {PARENT_DDR} },
     { INFO_BGR(CCU_HSTIMER_BGR_REG),  {PARENT_AHB0} },
     { INFO_BGR(CCU_PWM_BGR_REG),      {PARENT_APB0} },
     { INFO_BGR(CCU_UART_BGR_REG),     {PARENT_APB1} },
@@ -37,6 +37,7 @@ typedef enum {  // ids for Bus Gating Reset registers
     CCU_DMA_BGR_REG         = 0x070C,
     CCU_HSTIMER_BGR_REG     = 0x073C,
     CCU_PWM_BGR_REG         = 0x07AC,
+    CCU_MBUS_MAT_CLK_GATING_REG = 0x0804, // master gates onto MBUS, bit 0 is DMA
     CCU_DRAM_BGR_REG        = 0x080C,
     CCU_UART_BGR_REG        = 0x090C,
     CCU_TWI_BGR_REG         = 0x091C,  // TWI == I2C
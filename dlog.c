@@ -0,0 +1,107 @@
+/* File: dlog.c
+ * -------------
+ * Deferred log queues, see dlog.h.
+ */
+
+#include "dlog.h"
+#include "hal.h"
+#include "uart_tx.h"
+#include <stddef.h>
+
+#define MASK (DLOG_QUEUE_LEN - 1)
+
+typedef struct {
+    struct {
+        systime_t ticks; // orders the two queues' messages when they are merged
+        const char *fmt;
+        dlog_arg_t args[DLOG_MAX_ARGS];
+    } msgs[DLOG_QUEUE_LEN];
+    volatile unsigned int head, tail; // tail written by the producer, head by dlog_drain
+    volatile unsigned int dropped;
+    unsigned int dropped_shown;
+} dlog_queue_t;
+
+// [0] for the main program, [1] for interrupt handlers (and code running with them masked)
+static dlog_queue_t queues[2];
+
+bool dlog_write(const char *fmt, const dlog_arg_t args[DLOG_MAX_ARGS]) {
+    dlog_queue_t *q = &queues[!hal_irq_enabled()];
+    unsigned int tail = q->tail;
+
+    if (tail - q->head == DLOG_QUEUE_LEN) {
+        q->dropped++;
+        return false;
+    }
+    unsigned int slot = tail & MASK;
+    q->msgs[slot].ticks = systime_now();
+    q->msgs[slot].fmt = fmt;
+    for (int i = 0; i < DLOG_MAX_ARGS; i++) {
+        q->msgs[slot].args[i] = args[i];
+    }
+    q->tail = tail + 1;
+    return true;
+}
+
+// Prints a message one conversion at a time, so each argument reaches uart_tx_printf as
+// the type its conversion reads
+static void print_message(const char *fmt, const dlog_arg_t *args) {
+    char spec[16];
+    int next = 0;
+
+    while (*fmt) {
+        const char *text = fmt;
+        while (*fmt && *fmt != '%') fmt++;
+        if (fmt > text) uart_tx_write(text, fmt - text);
+        if (!*fmt) break;
+
+        int len = 0, longs = 0;
+        spec[len++] = *fmt++; // the %
+        while (*fmt && len < (int)sizeof(spec) - 2 && (*fmt == '-' || *fmt == '0' || (*fmt >= '1' && *fmt <= '9') || *fmt == 'l')) {
+            if (*fmt == 'l') longs++;
+            spec[len++] = *fmt++;
+        }
+        if (!*fmt) break;
+        char conv = *fmt++;
+        spec[len++] = conv;
+        spec[len] = '\0';
+
+        if (conv == '%') {
+            uart_tx_write("%", 1);
+        } else if (next == DLOG_MAX_ARGS) {
+            uart_tx_putstring("?"); // more conversions than arguments
+        } else if (conv == 's') {
+            const char *s = args[next++].s;
+            uart_tx_putstring(s ? s : "(null)");
+        } else if (longs) {
+            uart_tx_printf(spec, args[next++].l);
+        } else {
+            uart_tx_printf(spec, (int)args[next++].l);
+        }
+    }
+}
+
+int dlog_drain(int max) {
+    int printed = 0;
+    while (printed < max) {
+        dlog_queue_t *q = NULL;
+        for (int i = 0; i < 2; i++) { // the older of the two queue heads goes first
+            dlog_queue_t *c = &queues[i];
+            if (c->head == c->tail) continue;
+            if (!q || (int64_t)(c->msgs[c->head & MASK].ticks - q->msgs[q->head & MASK].ticks) < 0) q = c;
+        }
+        if (!q) break;
+
+        print_message(q->msgs[q->head & MASK].fmt, q->msgs[q->head & MASK].args);
+        q->head++;
+        printed++;
+
+        // messages are only dropped while the queue is full, so they came after all of its
+        // messages: report them once it has been emptied
+        unsigned int dropped = q->dropped;
+        if (q->head == q->tail && dropped != q->dropped_shown) {
+            uart_tx_printf("[dlog: %d messages dropped]\n", dropped - q->dropped_shown);
+            q->dropped_shown = dropped;
+        }
+    }
+    return printed;
+}
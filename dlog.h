@@ -0,0 +1,52 @@
+/* File: dlog.h
+ * -------------
+ * Deferred logging, safe to call from interrupt handlers. DLOG only copies the format
+ * pointer and up to DLOG_MAX_ARGS arguments into a queue, dlog_drain formats and
+ * prints them later from the main loop (the scheduler's idle hook), so no handler ever
+ * waits on the uart. When a queue is full the message is dropped and counted, and the
+ * count is printed once the messages queued before the drop are out.
+ *
+ * The format must be a string literal or otherwise outlive the queue. Integer arguments
+ * are stored as a long and handed to the conversion as an int, or as a long for an l
+ * modifier. String arguments are stored as the pointer, for %s, and must outlive the
+ * queue too, like a string literal or a name table entry.
+ *
+ * Interrupt handlers and the main program log into separate single-producer queues, so
+ * neither needs a lock. dlog_drain merges them back in time order.
+ */
+#ifndef _DLOG_H
+#define _DLOG_H
+
+#include "systime.h"
+#include <stdbool.h>
+
+#define DLOG_MAX_ARGS 4
+#define DLOG_QUEUE_LEN 32 // messages per queue, power of two
+
+typedef union {
+    long l; // every integer conversion
+    const char *s; // %s
+} dlog_arg_t;
+
+static inline dlog_arg_t dlog_long(long l) { return (dlog_arg_t){.l = l}; }
+static inline dlog_arg_t dlog_str(const char *s) { return (dlog_arg_t){.s = s}; }
+
+// Stores each argument in the member its type calls for
+#define DLOG_ARG(x) _Generic((x), char *: dlog_str, const char *: dlog_str, default: dlog_long)(x)
+#define DLOG_PICK(_0, _1, _2, _3, _4, map, ...) map
+#define DLOG_MAP0()
+#define DLOG_MAP1(a) DLOG_ARG(a)
+#define DLOG_MAP2(a, b) DLOG_ARG(a), DLOG_ARG(b)
+#define DLOG_MAP3(a, b, c) DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c)
+#define DLOG_MAP4(a, b, c, d) DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d)
+#define DLOG_MAP(...) DLOG_PICK(_0, ##__VA_ARGS__, DLOG_MAP4, DLOG_MAP3, DLOG_MAP2, DLOG_MAP1, DLOG_MAP0)(__VA_ARGS__)
+
+#define DLOG(fmt, ...) dlog_write((fmt), (const dlog_arg_t[DLOG_MAX_ARGS]){DLOG_MAP(__VA_ARGS__)})
+
+// Queues one message, returns false if it was dropped. Use through DLOG.
+bool dlog_write(const char *fmt, const dlog_arg_t args[DLOG_MAX_ARGS]);
+
+// Prints up to max queued messages, returns how many it printed
+int dlog_drain(int max);
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * D1 DMA controller driver, see chapter 3.9 of the D-1 user manual.
+ * Channels are started from a single descriptor and polled for completion.
+ */
+
+#include "dma.h"
+#include "assert.h"
+#include "ccu.h"
+#include <stddef.h>
+
+typedef union {
+    struct {
+        uint32_t irq_en[2];
+        uint32_t reserved0[2];
+        uint32_t irq_pend[2];
+        uint32_t reserved1[4];
+        uint32_t auto_gate;
+        uint32_t reserved2;
+        uint32_t status;
+        uint32_t reserved3[51];
+        struct {
+            uint32_t enable;
+            uint32_t pause;
+            uint32_t desc_addr;
+            uint32_t config;
+            uint32_t cur_src;
+            uint32_t cur_dst;
+            uint32_t bcnt_left;
+            uint32_t param;
+            uint32_t reserved0[2];
+            uint32_t mode;
+            uint32_t former_desc;
+            uint32_t pkg_num;
+            uint32_t reserved1[3];
+        } ch[DMA_NCHANNELS];
+    } regs;
+    uint8_t padding[0x1000];
+} dmac_t;
+
+#define DMAC_BASE ((dmac_t *)0x03002000)
+_Static_assert(&(DMAC_BASE->regs.status)          == (uint32_t *)0x03002030, "DMAC status reg must be at address 0x03002030");
+_Static_assert(&(DMAC_BASE->regs.ch[0].enable)    == (uint32_t *)0x03002100, "DMAC channel 0 enable reg must be at address 0x03002100");
+_Static_assert(&(DMAC_BASE->regs.ch[1].desc_addr) == (uint32_t *)0x03002148, "DMAC channel 1 desc reg must be at address 0x03002148");
+
+static volatile dmac_t *const module = DMAC_BASE;
+static bool initialized = false;
+
+// descriptor config fields
+#define CFG_SRC_DRQ(x)      ((x) << 0)
+#define CFG_SRC_IO_MODE     (1 << 8)
+#define CFG_DST_DRQ(x)      ((x) << 16)
+#define CFG_DST_IO_MODE     (1 << 24)
+// burst length and data width fields left at 0: single transfers of 8 bits
+
+void dma_init(void) {
+    // the DMA engine needs its bus clock and its master port onto MBUS (for DRAM access)
+    ccu_ungate_bus_clock(CCU_DMA_BGR_REG);
+    ccu_ungate_bus_clock_bits(CCU_MBUS_MAT_CLK_GATING_REG, (1 << 0), 0);
+    module->regs.irq_en[0] = 0;
+    module->regs.irq_en[1] = 0;
+    initialized = true;
+}
+
+void dma_desc_mem_to_dev(dma_desc_t *desc, const void *src, volatile void *dst, dma_drq_t dst_drq, int len) {
+    desc->config = CFG_SRC_DRQ(DMA_DRQ_DRAM) | CFG_DST_DRQ(dst_drq) | CFG_DST_IO_MODE;
+    desc->src = (uint32_t)(uintptr_t)src;
+    desc->dst = (uint32_t)(uintptr_t)dst;
+    desc->bcnt = len;
+    desc->param = 0;
+    desc->link = DMA_LINK_END;
+}
+
+void dma_start(int channel, dma_desc_t *desc) {
+    if (!initialized) error("dma_init() has not been called!\n");
+    assert(channel >= 0 && channel < DMA_NCHANNELS);
+    dma_clean_cache(desc, sizeof(*desc));
+    module->regs.ch[channel].enable = 0;
+    module->regs.ch[channel].desc_addr = (uint32_t)(uintptr_t)desc;
+    module->regs.ch[channel].enable = 1;
+}
+
+bool dma_busy(int channel) {
+    return (module->regs.status >> channel) & 1;
+}
+
+// The C906 data cache is only cleaned if it is on (mhcr.DE) and the T-Head cache
+// instructions are enabled (mxstatus.THEADISAEE), otherwise memory is already current.
+void dma_clean_cache(const void *buf, int len) {
+    unsigned long mhcr, mxstatus;
+    __asm__ volatile("csrr %0, 0x7c1" : "=r"(mhcr));
+    __asm__ volatile("csrr %0, 0x7c0" : "=r"(mxstatus));
+    if (!(mhcr & (1 << 1)) || !(mxstatus & (1 << 22))) return;
+
+    const int line = 64;
+    for (uintptr_t addr = (uintptr_t)buf & ~(line - 1); addr < (uintptr_t)buf + len; addr += line) {
+        register uintptr_t a0 __asm__("a0") = addr;
+        __asm__ volatile(".long 0x0255000b" :: "r"(a0) : "memory"); // dcache.cva a0
+    }
+    __asm__ volatile(".long 0x0190000b" ::: "memory"); // sync.s
+}
@@ -0,0 +1,46 @@
+#ifndef DMA_H__
+#define DMA_H__
+
+/*
+ * Minimal driver for the D1 DMA controller (DMAC), enough to stream a
+ * buffer from memory into a peripheral FIFO.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DMA_NCHANNELS 16
+
+// DRQ port numbers from the D1 manual, used as source or destination type
+typedef enum {
+    DMA_DRQ_SRAM = 0,
+    DMA_DRQ_DRAM = 1,
+    DMA_DRQ_SPI0 = 22,
+    DMA_DRQ_SPI1 = 23,
+} dma_drq_t;
+
+// Transfer descriptor as read by the controller, must be 4-byte aligned
+typedef struct {
+    uint32_t config;
+    uint32_t src;
+    uint32_t dst;
+    uint32_t bcnt;
+    uint32_t param;
+    uint32_t link; // next descriptor, DMA_LINK_END to stop
+} __attribute__((aligned(32))) dma_desc_t;
+
+#define DMA_LINK_END 0xfffff800
+
+void dma_init(void); // once to init dma module
+
+// Fills desc for a byte-wide copy of len bytes from memory into a peripheral data register
+void dma_desc_mem_to_dev(dma_desc_t *desc, const void *src, volatile void *dst, dma_drq_t dst_drq, int len);
+
+void dma_start(int channel, dma_desc_t *desc);
+
+bool dma_busy(int channel);
+
+// Writes back any cached copy of buf so the controller reads what the CPU wrote
+void dma_clean_cache(const void *buf, int len);
+
+#endif
@@ -13,28 +13,23 @@
 */
 
 
-#include "timer.h"
+#include "systime.h"
+#include "hal.h"
 #include "spi.h"
 #include "strings.h"
 #include "gpio.h"
+#include "dotstar.h"
+#include "gpio_port.h"
 
-// brightness range: 0 (off) to 31 (crazy bright)
-#define DEFAULT_BRIGHTNESS 10
+static struct {
+    uint8_t storage[2][DOTSTAR_FRAME_BYTES(DOTSTAR_MAX_LEDS)] __attribute__((aligned(64)));
+    dotstar_buffer_t buffers[2];
+    int front;  // buffer DMA reads from, the other one is the back buffer
+    int nleds;
+    bool initialized;
+} strip1;
 
-typedef struct {
-    uint32_t bright : 5;
-    uint32_t header : 3; // fixed 0b111
-    uint32_t blue   : 8;
-    uint32_t green  : 8;
-    uint32_t red    : 8;
-} led_t;
-
-#define COLOR(r, g, b) ((led_t){.header = 0b111, .bright= DEFAULT_BRIGHTNESS, .red = (r), .green = (g), .blue = (b)})
-
-typedef struct {
-    gpio_id_t mosi;
-    gpio_id_t sclk;
-} led_strip;
+static unsigned long cpu_hz; // measured once by spi2_init
 
 // Initialize a set of spi pins used for LED strip, copy spi pin information to led strip struct
 void spi2_init(led_strip *strip, gpio_id_t SPI2_MOSI, gpio_id_t SPI2_SCLK) {
@@ -44,67 +39,210 @@ void spi2_init(led_strip *strip, gpio_id_t SPI2_MOSI, gpio_id_t SPI2_SCLK) {
     gpio_write(SPI2_SCLK, 0);
     strip->mosi = SPI2_MOSI;
     strip->sclk = SPI2_SCLK;
+    strip->mosi_port = GPIO_PORT_OF(SPI2_MOSI);
+    strip->sclk_port = GPIO_PORT_OF(SPI2_SCLK);
+    strip->mosi_bit = 1u << GPIO_INDEX_OF(SPI2_MOSI);
+    strip->sclk_bit = 1u << GPIO_INDEX_OF(SPI2_SCLK);
+
+    if (cpu_hz == 0) cpu_hz = hal_measure_cycles_per_ms() * 1000;
+    spi2_set_clock(strip, SPI2_DEFAULT_CLOCK_HZ);
 }
 
-// Write a byte of data to the led strip struct
-void spi2_send_byte(led_strip *strip, uint8_t byte) {
+void spi2_set_clock(led_strip *strip, long hz) {
+    strip->half_period_cycles = cpu_hz / (2 * hz);
+    if (strip->half_period_cycles == 0) strip->half_period_cycles = 1;
+}
+
+// Clocks out one byte, MSB first. Each edge is scheduled from the previous edge's
+// deadline in CPU cycles, so register writes and loop overhead do not stretch the clock.
+// Port D is shared with the display and buzzer pins that interrupt handlers drive, so
+// every pin change goes through the masked gpio_port_modify.
+static void send_byte(led_strip *strip, uint8_t byte, unsigned long *deadline) {
+    const unsigned int mosi = strip->mosi_port, sclk = strip->sclk_port;
+    const uint32_t mosi_bit = strip->mosi_bit, sclk_bit = strip->sclk_bit;
+    const unsigned long half = strip->half_period_cycles;
+    unsigned long next = *deadline;
+
     for (int i = 7; i >= 0; i--) {
-        // set spi2 MOSI data to the current bit
-        gpio_write(strip->mosi, (byte >> i) & 1);
-
-        // pulse high and low to start reading bit
-        gpio_write(strip->sclk, 1); // high
-        timer_delay_us(1);
-        gpio_write(strip->sclk, 0); // low
-        timer_delay_us(1);
+        // set spi2 MOSI data to the current bit, it is sampled on the rising edge
+        gpio_port_modify(mosi, mosi_bit, ((byte >> i) & 1) ? mosi_bit : 0);
+
+        next += half;
+        while ((long)(hal_cycles() - next) < 0) {}
+        gpio_port_modify(sclk, 0, sclk_bit); // high
+        next += half;
+        while ((long)(hal_cycles() - next) < 0) {}
+        gpio_port_modify(sclk, sclk_bit, 0); // low
     }
+    *deadline = next;
+}
+
+// Write a byte of data to the led strip struct
+void spi2_send_byte(led_strip *strip, uint8_t byte) {
+    unsigned long deadline = hal_cycles();
+    send_byte(strip, byte, &deadline);
 }
 
 void spi2_transfer(led_strip *strip, uint8_t *data, int len) {
+    unsigned long deadline = hal_cycles();
     for (int i = 0; i < len; i++) { // send data buffer information
-        spi2_send_byte(strip, data[i]);
+        send_byte(strip, data[i], &deadline);
     }
 }
 
-// if spi2 true, send data to second led strip
-void show_strip(led_strip *strip, led_t *pixels, int n, bool spi2) {
-    int n_start = 4;
-    int n_end = (n/2)/8 + 1; // half-bit per pixel
-    int n_total = n_start + n*sizeof(led_t) + n_end;
-    uint8_t strip_data[n_total], unused[n_total];
+void dotstar_buffer_init(dotstar_buffer_t *buf, uint8_t *storage, int nleds) {
+    buf->frame = storage;
+    buf->pixels = (led_t *)&storage[DOTSTAR_START_BYTES];
+    buf->nleds = nleds;
+    buf->len = DOTSTAR_FRAME_BYTES(nleds);
 
-    memset(&strip_data[0], 0, n_start);                     // start frame
-    memcpy(&strip_data[4], pixels, n*sizeof(led_t));        // pixel data
-    memset(&strip_data[4 + n*sizeof(led_t)], 0xff, n_end);  // end frame
+    memset(storage, 0, DOTSTAR_START_BYTES);                        // start frame
+    for (int i = 0; i < nleds; i++) {
+        buf->pixels[i] = COLOR(0, 0, 0);
+    }
+    memset(&buf->pixels[nleds], 0xff, DOTSTAR_END_BYTES(nleds));    // end frame
+}
 
+void dotstar_buffer_show(led_strip *strip, const dotstar_buffer_t *buf, bool spi2) {
     if (spi2) {
-        spi2_transfer(strip, strip_data, sizeof(strip_data));
+        spi2_transfer(strip, buf->frame, buf->len);
+    }
+    else {
+        spi_write(buf->frame, buf->len);
+    }
+}
+
+// Lays out start frame, dark pixels and end frame in both buffers of strip 1
+void dotstar_init(int nleds) {
+    if (nleds > DOTSTAR_MAX_LEDS) nleds = DOTSTAR_MAX_LEDS;
+    strip1.nleds = nleds;
+    strip1.front = 0;
+    for (int f = 0; f < 2; f++) {
+        dotstar_buffer_init(&strip1.buffers[f], strip1.storage[f], nleds);
     }
+    strip1.initialized = true;
+}
+
+led_t *dotstar_back_buffer(void) {
+    return strip1.buffers[!strip1.front].pixels;
+}
+
+void dotstar_present(void) {
+    // the back buffer becomes the front, so the old front must be done streaming
+    // before it can be handed back for rendering
+    while (spi_busy())
+        ;
+    strip1.front = !strip1.front;
+    const dotstar_buffer_t *buf = &strip1.buffers[strip1.front];
+    spi_write_dma(buf->frame, buf->len);
+}
+
+bool dotstar_busy(void) {
+    return spi_busy();
+}
+
+void dotstar_encoder_init(dotstar_encoder_t *enc, const led_t *pixels, led_t color, int nleds) {
+    enc->pixels = pixels;
+    enc->color = color;
+    enc->nleds = nleds;
+    enc->pos = 0;
+    enc->len = DOTSTAR_FRAME_BYTES(nleds);
+}
 
+int dotstar_encode(dotstar_encoder_t *enc, uint8_t *chunk, int max) {
+    const int pixel_end = DOTSTAR_START_BYTES + enc->nleds * sizeof(led_t);
+    int n = 0;
+    while (n < max && enc->pos < enc->len) {
+        int pos = enc->pos++;
+        if (pos < DOTSTAR_START_BYTES) {
+            chunk[n++] = 0x00;                                   // start frame
+        } else if (pos < pixel_end) {
+            int offset = pos - DOTSTAR_START_BYTES;
+            led_t px = enc->pixels ? enc->pixels[offset / sizeof(led_t)] : enc->color;
+            chunk[n++] = ((const uint8_t *)&px)[offset % sizeof(led_t)]; // pixel data
+        } else {
+            chunk[n++] = 0xff;                                   // end frame
+        }
+    }
+    return n;
+}
+
+// Streams a frame to strip 2, the clock deadline carries across chunks
+static void stream_spi2(led_strip *strip, dotstar_encoder_t *enc) {
+    uint8_t chunk[DOTSTAR_CHUNK_BYTES];
+    unsigned long deadline = hal_cycles();
+    int n;
+    while ((n = dotstar_encode(enc, chunk, sizeof(chunk))) > 0) {
+        for (int i = 0; i < n; i++) {
+            send_byte(strip, chunk[i], &deadline);
+        }
+    }
+}
+
+// Streams a frame over SPI1 without DMA, for when dotstar_init has not been called
+static void stream_spi1(dotstar_encoder_t *enc) {
+    uint8_t chunk[DOTSTAR_CHUNK_BYTES];
+    int n;
+    while ((n = dotstar_encode(enc, chunk, sizeof(chunk))) > 0) {
+        spi_write(chunk, n);
+    }
+}
+
+// Renders n pixels (color when pixels is NULL) into the strip 1 back buffer and starts it
+static void present_strip1(const led_t *pixels, led_t color, int n) {
+    led_t *back = dotstar_back_buffer();
+    for (int i = 0; i < strip1.nleds; i++) {
+        back[i] = (i >= n) ? COLOR(0, 0, 0) : pixels ? pixels[i] : color;
+    }
+    dotstar_present(); // starts the DMA and returns
+}
+
+static void show_one(led_strip *strip, const led_t *pixels, led_t color, int n, bool spi2) {
+    dotstar_encoder_t enc;
+    if (!spi2 && strip1.initialized) {
+        present_strip1(pixels, color, n);
+        return;
+    }
+
+    dotstar_encoder_init(&enc, pixels, color, n);
+    if (spi2) {
+        stream_spi2(strip, &enc);
+    }
     else {
-        spi_transfer(strip_data, unused, sizeof(strip_data));
+        stream_spi1(&enc);
     }
 }
 
+// if spi2 true, send data to second led strip
+void show_strip(led_strip *strip, led_t *pixels, int n, bool spi2) {
+    show_one(strip, pixels, COLOR(0, 0, 0), n, spi2);
+}
+
 // The display color function takes in a strip struct containing information about the 
 // led strip clock an data pins, the number of leds to be turned on, the rgb values for the led,
 // and a boolean condition of whether or not this is using the hardware assigned spi pins or 
 // digitally assigned spi pins. 
 void display_color(led_strip *strip, int nleds, uint8_t r, uint8_t g, uint8_t b, bool spi2) {
-    led_t led_strip_array[nleds];
+    show_one(strip, NULL, COLOR(r, g, b), nleds, spi2);
+}
 
-    for (int i = 0; i < nleds; i++) { // initialize all elements of the array to 0 to clear garbage data
-        led_strip_array[i] = COLOR(0, 0, 0);
+static void show_both(led_strip *strip2, const led_t *pixels1, const led_t *pixels2,
+                      led_t color1, led_t color2, int n) {
+    dotstar_encoder_t enc;
+    if (strip1.initialized) {
+        present_strip1(pixels1, color1, n);
+    } else {
+        dotstar_encoder_init(&enc, pixels1, color1, n);
+        stream_spi1(&enc); // no DMA buffers, falls back to serial
     }
+    dotstar_encoder_init(&enc, pixels2, color2, n);
+    stream_spi2(strip2, &enc);
+}
 
-    for (int i = 0; i < nleds; i++) {
-        led_strip_array[i] = COLOR(r, g, b);
-    }
+void show_strips(led_strip *strip2, const led_t *pixels1, const led_t *pixels2, int n) {
+    show_both(strip2, pixels1, pixels2, COLOR(0, 0, 0), COLOR(0, 0, 0), n);
+}
 
-    if (spi2) {
-        show_strip(strip, led_strip_array, nleds, true);
-    }
-    else {
-        show_strip(strip, led_strip_array, nleds, false);
-    }
-}
\ No newline at end of file
+void display_colors(led_strip *strip2, int nleds, led_t color1, led_t color2) {
+    show_both(strip2, NULL, NULL, color1, color2, nleds);
+}
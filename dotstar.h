@@ -4,7 +4,9 @@
 #include "timer.h"
 #include "spi.h"
 #include "strings.h"
+#include "gpio.h"
 
+// brightness range: 0 (off) to 31 (crazy bright)
 #define DEFAULT_BRIGHTNESS 10
 
 typedef struct {
@@ -21,19 +23,90 @@ typedef struct {
 typedef struct {
     gpio_id_t mosi;
     gpio_id_t sclk;
+    unsigned int mosi_port, sclk_port; // ports and bit masks of the pins, written directly
+    uint32_t mosi_bit, sclk_bit;
+    unsigned long half_period_cycles; // CPU cycles per half clock period
 } led_strip;
 
+#define SPI2_DEFAULT_CLOCK_HZ 2000000 // same rate as hardware SPI1
+
 #define SPI2_MOSI GPIO_PC1
 #define SPI2_SCLK GPIO_PD15
 
 void spi2_init(led_strip *strip, gpio_id_t SPI2_MOSI, gpio_id_t SPI2_SCLK);
 
+// Sets the bit-banged clock rate, the achieved rate is within one CPU cycle per half period
+void spi2_set_clock(led_strip *strip, long hz);
+
 void spi2_send_byte(led_strip *strip, uint8_t byte);
 
 void spi2_transfer(led_strip *strip, uint8_t *data, int len);
 
 void show_strip(led_strip *strip, led_t *pixels, int n, bool spi2);
 
+// Strip 1 (hardware SPI1) is double buffered: render into the back buffer while the
+// front buffer is streamed out by DMA, then call dotstar_present to swap them.
+// Both buffers already hold the start and end frames around the pixels.
+#ifndef DOTSTAR_MAX_LEDS
+#define DOTSTAR_MAX_LEDS 144 // sizes the static strip buffers, override with -DDOTSTAR_MAX_LEDS=n
+#endif
+#define DOTSTAR_START_BYTES 4
+#define DOTSTAR_END_BYTES(n) (((n)/2)/8 + 1) // half-bit per pixel
+#define DOTSTAR_FRAME_BYTES(n) (DOTSTAR_START_BYTES + (n)*sizeof(led_t) + DOTSTAR_END_BYTES(n))
+
+// A complete frame in one block: start frame, pixels, end frame. Pixels are rendered in
+// place and the frame is sent as is, without copying.
+typedef struct {
+    uint8_t *frame;
+    led_t *pixels; // inside frame, just past the start frame
+    int nleds;
+    int len;       // bytes in frame
+} dotstar_buffer_t;
+
+// storage for a buffer of n leds, e.g. static DOTSTAR_BUFFER_STORAGE(hoop_frame, 60);
+#define DOTSTAR_BUFFER_STORAGE(name, n) uint8_t name[DOTSTAR_FRAME_BYTES(n)] __attribute__((aligned(4)))
+
+// storage must hold DOTSTAR_FRAME_BYTES(nleds), all pixels start off
+void dotstar_buffer_init(dotstar_buffer_t *buf, uint8_t *storage, int nleds);
+
+// sends the frame, over transmit-only SPI1 or bit-banged to strip if spi2
+void dotstar_buffer_show(led_strip *strip, const dotstar_buffer_t *buf, bool spi2);
+
+void dotstar_init(int nleds);
+
+// Produces a frame a chunk at a time, so strips of any length go out without a full copy
+// of the frame. pixels NULL sends color on every led.
+#define DOTSTAR_CHUNK_BYTES 32
+
+typedef struct {
+    const led_t *pixels;
+    led_t color;
+    int nleds;
+    int pos;  // next frame byte to emit
+    int len;
+} dotstar_encoder_t;
+
+void dotstar_encoder_init(dotstar_encoder_t *enc, const led_t *pixels, led_t color, int nleds);
+
+// fills up to max bytes of chunk, returns how many, 0 once the end frame is out
+int dotstar_encode(dotstar_encoder_t *enc, uint8_t *chunk, int max);
+
+// pixels for the next frame, holds an older frame until overwritten
+led_t *dotstar_back_buffer(void);
+
+// waits for the previous frame to finish, then starts sending the back buffer
+void dotstar_present(void);
+
+bool dotstar_busy(void);
+
+// Refreshes both strips together: both frames are rendered first, then strip 1 starts
+// streaming by DMA and strip 2 is bit-banged while it drains. Returns once strip 2 is
+// sent, strip 1 finishes in the background (see dotstar_busy).
+void show_strips(led_strip *strip2, const led_t *pixels1, const led_t *pixels2, int n);
+
+// solid colors on both strips, refreshed together by show_strips
+void display_colors(led_strip *strip2, int nleds, led_t color1, led_t color2);
+
 // function to display solid rgb color on all leds, if spi2 false then color displayed on first led strip connected to hardware spi1 pins (PD11 and PD12)
 void display_color(led_strip *strip, int nleds, uint8_t r, uint8_t g, uint8_t b, bool spi2);
 
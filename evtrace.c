@@ -0,0 +1,83 @@
+/* File: evtrace.c
+ * -------------
+ * Overwrite-oldest event ring, see evtrace.h.
+ */
+
+#include "evtrace.h"
+#include "hal.h"
+#include "uart_tx.h"
+
+#define MASK (EVTRACE_LEN - 1)
+
+static struct {
+    evtrace_event_t ring[EVTRACE_LEN];
+    uint32_t count; // events recorded since the last clear, the newest is at (count - 1) & MASK
+} trace;
+
+void evtrace_record(evtrace_type_t type, uint8_t a, uint16_t b, uint32_t c) {
+    unsigned long irq = hal_irq_save(); // interrupt handlers record too
+    evtrace_event_t *ev = &trace.ring[trace.count++ & MASK];
+    ev->ticks = systime_now();
+    ev->type = type;
+    ev->a = a;
+    ev->b = b;
+    ev->c = c;
+    hal_irq_restore(irq);
+}
+
+void evtrace_clear(void) {
+    trace.count = 0;
+}
+
+static struct {
+    int column;
+    uint32_t crc;
+} out;
+
+// Prints bytes as hex, 32 to a line, and folds them into the frame's CRC
+static void emit(const void *bytes, int n) {
+    static const char digits[] = "0123456789abcdef";
+    const uint8_t *p = bytes;
+    out.crc = evtrace_crc32_update(out.crc, p, n);
+    for (int i = 0; i < n; i++) {
+        char hex[3] = {digits[p[i] >> 4], digits[p[i] & 0xf], '\n'};
+        uart_tx_write(hex, ++out.column == 32 ? 3 : 2);
+        if (out.column == 32) out.column = 0;
+    }
+}
+
+static void emit_u32(uint32_t val) {
+    uint8_t bytes[4] = {val, val >> 8, val >> 16, val >> 24};
+    emit(bytes, 4);
+}
+
+void evtrace_dump(void) {
+    static evtrace_event_t snapshot[EVTRACE_LEN];
+
+    // copy the ring so handlers recording during the slow uart output don't tear it
+    unsigned long irq = hal_irq_save();
+    uint32_t count = trace.count;
+    uint32_t n = count < EVTRACE_LEN ? count : EVTRACE_LEN;
+    for (uint32_t i = 0; i < n; i++) {
+        snapshot[i] = trace.ring[(count - n + i) & MASK];
+    }
+    hal_irq_restore(irq);
+
+    out.column = 0;
+    out.crc = EVTRACE_CRC_INIT;
+    uart_tx_printf("\nEVTRACE 1 %d\n", (int)(EVTRACE_HEADER_BYTES + n * 16 + 4));
+    emit("EVT1", 4);
+    emit_u32(n);
+    emit_u32(count - n);
+    for (uint32_t i = 0; i < n; i++) { // field by field, little endian like the host
+        const evtrace_event_t *ev = &snapshot[i];
+        emit_u32(ev->ticks);
+        emit_u32(ev->ticks >> 32);
+        uint8_t head[4] = {ev->type, ev->a, ev->b, ev->b >> 8};
+        emit(head, 4);
+        emit_u32(ev->c);
+    }
+    emit_u32(~out.crc);
+    if (out.column) uart_tx_printf("\n");
+    uart_tx_printf("EVTRACE END\n");
+}
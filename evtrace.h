@@ -0,0 +1,64 @@
+/* File: evtrace.h
+ * -------------
+ * Always-on event trace. Drivers and the game record typed events into a fixed ring in RAM,
+ * which overwrites the oldest events once it is full, so the ring always holds the most
+ * recent EVTRACE_LEN events. Each event is 16 bytes with a 64-bit tick timestamp, and
+ * recording one masks interrupts for a few loads and stores, so it is safe from any
+ * context and cheap enough to leave on.
+ *
+ * evtrace_dump prints the ring over the uart as one frame, hex between marker lines:
+ *     EVTRACE 1 <bytes>
+ *     <up to 32 bytes of hex per line>
+ *     EVTRACE END
+ * The frame is the 4-byte magic "EVT1", the event count and the number of events
+ * overwritten before them (both 32-bit little endian), the events oldest first, and a
+ * CRC-32 of everything before it. host/evdecode turns it into a text timeline and a
+ * Chrome trace (chrome://tracing, ui.perfetto.dev).
+ */
+#ifndef _EVTRACE_H
+#define _EVTRACE_H
+
+#include "systime.h"
+#include <stdint.h>
+
+#define EVTRACE_LEN 512 // events, power of two
+#define EVTRACE_HEADER_BYTES 12
+
+typedef enum {
+    EVT_SHOT = 1,      // a: hoop, b: scoring_result_t << 8 | points, c: transit ticks
+    EVT_SCORE,         // a: team, c: new score
+    EVT_TEAM_SWAP,     // a: number of hoops, c: each hoop's new team, 4 bits per hoop from bit 0
+    EVT_DISPLAY_FRAME, // a: frame length, b: display clock pin, c: frame bytes, first in the low byte
+    EVT_LED_FRAME,     // c: leds per strip
+    EVT_NOTE_START,    // a: note index in the melody, c: half period in ticks, 0 for a rest
+} evtrace_type_t;
+
+typedef struct {
+    uint64_t ticks;
+    uint8_t type;
+    uint8_t a;
+    uint16_t b;
+    uint32_t c;
+} evtrace_event_t;
+
+void evtrace_record(evtrace_type_t type, uint8_t a, uint16_t b, uint32_t c);
+
+void evtrace_clear(void);
+
+void evtrace_dump(void);
+
+#define EVTRACE_CRC_INIT 0xFFFFFFFF
+
+// Folds len bytes into a running CRC-32 (IEEE, reflected). Start from EVTRACE_CRC_INIT and
+// invert the result at the end. Shared with the host decoder.
+static inline uint32_t evtrace_crc32_update(uint32_t crc, const uint8_t *buf, int len) {
+    for (int i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/* File: gpio_port.c
+ * -------------
+ * Batched, register-level GPIO writes, see gpio_port.h.
+ */
+
+#include "gpio_port.h"
+#include "strings.h"
+
+void gpio_batch_clear(gpio_batch_t *batch) {
+    memset(batch, 0, sizeof(*batch));
+}
+
+void gpio_batch_write(gpio_batch_t *batch, gpio_id_t pin, int val) {
+    unsigned int port = GPIO_PORT_OF(pin);
+    uint32_t bit = 1u << GPIO_INDEX_OF(pin);
+
+    if (val) {
+        batch->dat_set[port] |= bit;
+        batch->dat_clr[port] &= ~bit;
+    }
+    else {
+        batch->dat_clr[port] |= bit;
+        batch->dat_set[port] &= ~bit;
+    }
+    batch->ports_touched |= (1 << port);
+}
+
+void gpio_batch_set_function(gpio_batch_t *batch, gpio_id_t pin, unsigned int function) {
+    unsigned int port = GPIO_PORT_OF(pin);
+    unsigned int index = GPIO_INDEX_OF(pin);
+    unsigned int shift = (index % 8) * 4;
+
+    batch->cfg_mask[port][index / 8] |= (0xfu << shift);
+    batch->cfg_val[port][index / 8] = (batch->cfg_val[port][index / 8] & ~(0xfu << shift)) | ((function & 0xf) << shift);
+    batch->ports_touched |= (1 << port);
+}
+
+void gpio_batch_apply(gpio_batch_t *batch) {
+    for (unsigned int port = 0; port < GPIO_NPORTS; port++) {
+        if (!(batch->ports_touched & (1 << port))) continue;
+        if (batch->dat_set[port] | batch->dat_clr[port]) {
+            gpio_port_modify(port, batch->dat_clr[port], batch->dat_set[port]);
+        }
+        for (int i = 0; i < 4; i++) {
+            if (batch->cfg_mask[port][i]) {
+                unsigned long irq = hal_irq_save();
+                hal_gpio_cfg_write(port, i, (hal_gpio_cfg_read(port, i) & ~batch->cfg_mask[port][i]) | batch->cfg_val[port][i]);
+                hal_irq_restore(irq);
+            }
+        }
+    }
+}
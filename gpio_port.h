@@ -0,0 +1,61 @@
+/* File: gpio_port.h
+ * -------------
+ * Port-level access to the D1 GPIO registers. Changes to several pins are collected
+ * in a gpio_batch_t and applied with one read-modify-write per register touched, so
+ * pins on the same port switch in the same instant. Also has single-pin helpers that
+ * skip the bookkeeping in gpio_write/gpio_read for bit-banged protocols.
+ *
+ * Interrupt handlers write pins too (the display transmitter, the sound player), often on
+ * the same port as main-loop code. Every read-modify-write here runs with interrupts
+ * masked, so a handler can't change the port between the read and the write and have its
+ * change undone.
+ */
+#ifndef _GPIO_PORT_H
+#define _GPIO_PORT_H
+
+#include "gpio.h"
+#include "hal.h"
+#include <stdint.h>
+
+#define GPIO_NPORTS 7 // PA through PG, PA is not wired on the D1 but keeps its register slot
+
+// a gpio_id_t is the port number in the upper byte and the pin index in the lower byte
+#define GPIO_PORT_OF(pin)  ((unsigned int)(pin) >> 8)
+#define GPIO_INDEX_OF(pin) ((unsigned int)(pin) & 0xff)
+
+typedef struct {
+    uint32_t dat_set[GPIO_NPORTS];
+    uint32_t dat_clr[GPIO_NPORTS];
+    uint32_t cfg_mask[GPIO_NPORTS][4];
+    uint32_t cfg_val[GPIO_NPORTS][4];
+    uint8_t ports_touched; // bit per port
+} gpio_batch_t;
+
+void gpio_batch_clear(gpio_batch_t *batch);
+
+void gpio_batch_write(gpio_batch_t *batch, gpio_id_t pin, int val);
+
+// function is one of GPIO_FN_INPUT, GPIO_FN_OUTPUT, ...
+void gpio_batch_set_function(gpio_batch_t *batch, gpio_id_t pin, unsigned int function);
+
+// Applies all data changes and then all function changes, so a pin switched to output
+// already drives its new value.
+void gpio_batch_apply(gpio_batch_t *batch);
+
+// Clears then sets bits of a port's data register in one masked read-modify-write
+static inline void gpio_port_modify(unsigned int port, uint32_t clr, uint32_t set) {
+    unsigned long irq = hal_irq_save();
+    hal_gpio_dat_write(port, (hal_gpio_dat_read(port) & ~clr) | set);
+    hal_irq_restore(irq);
+}
+
+static inline void gpio_port_write(gpio_id_t pin, int val) {
+    uint32_t bit = 1u << GPIO_INDEX_OF(pin);
+    gpio_port_modify(GPIO_PORT_OF(pin), bit, val ? bit : 0);
+}
+
+static inline int gpio_port_read(gpio_id_t pin) {
+    return (hal_gpio_dat_read(GPIO_PORT_OF(pin)) >> GPIO_INDEX_OF(pin)) & 1;
+}
+
+#endif
@@ -0,0 +1,171 @@
+/* File: hal.h
+ * -------------
+ * Hardware touch points that the drivers use directly instead of going through the CS107e
+ * library: the GPIO port registers, the CPU cycle counter, the SPI register block, the
+ * UART0 transmitter, the high-speed timers' interval and count, and masking interrupts
+ * around short critical sections.
+ * GPIO, timer ticks and interrupts otherwise go through the library (gpio.h, timer.h,
+ * hstimer.h, interrupts.h, gpio_interrupt.h), which is the rest of the HAL.
+ *
+ * On the board everything here is a plain register access. The host build (make host,
+ * HOST_BUILD defined) links the mock peripherals in host/ instead, which keep a virtual
+ * clock and record every pin change, see host/mock.h.
+ */
+#ifndef _HAL_H
+#define _HAL_H
+
+#include "systime.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// register layout of one GPIO port, ports are 0x30 apart starting at 0x02000000
+typedef struct {
+    uint32_t cfg[4];  // 4 bits of function select per pin
+    uint32_t dat;
+    uint32_t drv[4];
+    uint32_t pull[2];
+    uint32_t reserved;
+} gpio_port_regs_t;
+
+#ifdef HOST_BUILD
+
+uint32_t hal_gpio_dat_read(unsigned int port);
+void hal_gpio_dat_write(unsigned int port, uint32_t val);
+uint32_t hal_gpio_cfg_read(unsigned int port, int reg);
+void hal_gpio_cfg_write(unsigned int port, int reg, uint32_t val);
+unsigned long hal_cycles(void);
+unsigned long hal_irq_save(void);
+void hal_irq_restore(unsigned long flags);
+bool hal_irq_enabled(void);
+bool hal_uart_tx_ready(void);
+bool hal_uart_tx_idle(void);
+void hal_uart_tx_put(uint8_t byte);
+void hal_uart_tx_irq(bool enable);
+void hal_uart_irq_ack(void);
+void hal_hstimer_set_interval(int timer, uint32_t ticks);
+uint32_t hal_hstimer_elapsed(int timer);
+
+#else
+
+#define HAL_GPIO_BASE ((volatile gpio_port_regs_t *)0x02000000)
+#define HAL_SPI_BASE  0x04025000 // SPI0, SPI1 follows 0x1000 later
+#define HAL_UART_BASE 0x02500000 // UART0, the console
+
+// UART0 registers, as 32-bit words
+#define HAL_UART_REG(offset) (*(volatile uint32_t *)(HAL_UART_BASE + (offset)))
+#define HAL_UART_THR HAL_UART_REG(0x00)
+#define HAL_UART_IER HAL_UART_REG(0x04)
+#define HAL_UART_IIR HAL_UART_REG(0x08)
+#define HAL_UART_LSR HAL_UART_REG(0x14)
+#define HAL_UART_USR HAL_UART_REG(0x7C)
+#define HAL_UART_IER_ETBEI (1 << 1) // interrupt when the transmit FIFO is empty
+#define HAL_UART_LSR_TEMT  (1 << 6) // FIFO and shift register empty
+#define HAL_UART_USR_TFNF  (1 << 1) // transmit FIFO not full
+#define HAL_HSTIMER_BASE 0x03008000
+
+// registers of high-speed timer 0 or 1, which count down at 200 MHz
+#define HAL_HSTIMER_REG(timer, offset) (*(volatile uint32_t *)(HAL_HSTIMER_BASE + 0x20 + 0x20UL * (timer) + (offset)))
+#define HAL_HSTIMER_CTRL(timer)    HAL_HSTIMER_REG(timer, 0x00)
+#define HAL_HSTIMER_INTV_LO(timer) HAL_HSTIMER_REG(timer, 0x04)
+#define HAL_HSTIMER_INTV_HI(timer) HAL_HSTIMER_REG(timer, 0x08)
+#define HAL_HSTIMER_CUR_LO(timer)  HAL_HSTIMER_REG(timer, 0x0C)
+#define HAL_HSTIMER_CTRL_RELOAD (1 << 1)
+
+static inline uint32_t hal_gpio_dat_read(unsigned int port) {
+    return HAL_GPIO_BASE[port].dat;
+}
+
+static inline void hal_gpio_dat_write(unsigned int port, uint32_t val) {
+    HAL_GPIO_BASE[port].dat = val;
+}
+
+static inline uint32_t hal_gpio_cfg_read(unsigned int port, int reg) {
+    return HAL_GPIO_BASE[port].cfg[reg];
+}
+
+static inline void hal_gpio_cfg_write(unsigned int port, int reg, uint32_t val) {
+    HAL_GPIO_BASE[port].cfg[reg] = val;
+}
+
+// CPU cycles since reset
+static inline unsigned long hal_cycles(void) {
+    unsigned long cycles;
+    __asm__ volatile("csrr %0, mcycle" : "=r"(cycles));
+    return cycles;
+}
+
+// room in the transmit FIFO for another byte
+static inline bool hal_uart_tx_ready(void) {
+    return HAL_UART_USR & HAL_UART_USR_TFNF;
+}
+
+// every byte has left the shift register
+static inline bool hal_uart_tx_idle(void) {
+    return HAL_UART_LSR & HAL_UART_LSR_TEMT;
+}
+
+static inline void hal_uart_tx_put(uint8_t byte) {
+    HAL_UART_THR = byte;
+}
+
+static inline void hal_uart_tx_irq(bool enable) {
+    if (enable) HAL_UART_IER |= HAL_UART_IER_ETBEI;
+    else HAL_UART_IER &= ~HAL_UART_IER_ETBEI;
+}
+
+// reading IIR clears a pending transmit-empty interrupt
+static inline void hal_uart_irq_ack(void) {
+    (void)HAL_UART_IIR;
+}
+
+// Sets the interval of a timer that hstimer_init has set up, in 24 MHz systime ticks
+// instead of the whole microseconds hstimer_init takes. 200 MHz is 25/3 clocks per tick.
+// Call between hstimer_disable and hstimer_enable.
+static inline void hal_hstimer_set_interval(int timer, uint32_t ticks) {
+    uint64_t clocks = (uint64_t)ticks * 25 / 3;
+    HAL_HSTIMER_INTV_LO(timer) = clocks;
+    HAL_HSTIMER_INTV_HI(timer) = clocks >> 32;
+    HAL_HSTIMER_CTRL(timer) |= HAL_HSTIMER_CTRL_RELOAD; // counter starts over from the new interval
+}
+
+// 200 MHz clocks since the timer last reloaded, which is when its interrupt was raised.
+// Only the low words, every interval in use is far below 2^32 clocks (21 s).
+static inline uint32_t hal_hstimer_elapsed(int timer) {
+    return HAL_HSTIMER_INTV_LO(timer) - HAL_HSTIMER_CUR_LO(timer);
+}
+
+// Masks interrupts and returns whether they were enabled. Unlike interrupts_global_disable
+// it nests, and is safe inside an interrupt handler.
+static inline unsigned long hal_irq_save(void) {
+    unsigned long mstatus;
+    __asm__ volatile("csrrci %0, mstatus, 8" : "=r"(mstatus) : : "memory"); // clear MIE
+    return mstatus & 8;
+}
+
+static inline void hal_irq_restore(unsigned long flags) {
+    __asm__ volatile("csrs mstatus, %0" : : "r"(flags) : "memory");
+}
+
+// false inside an interrupt handler (the trap clears MIE) or between save and restore
+static inline bool hal_irq_enabled(void) {
+    unsigned long mstatus;
+    __asm__ volatile("csrr %0, mstatus" : "=r"(mstatus));
+    return mstatus & 8;
+}
+
+#endif
+
+#define HAL_HSTIMER_HZ 200000000
+
+// Counts CPU cycles across 1 ms of the 24 MHz timer, the clock rate for turning cycle
+// counts into time. Takes up to 2 ms.
+static inline unsigned long hal_measure_cycles_per_ms(void) {
+    systime_t start_ticks = systime_now();
+    while (systime_now() == start_ticks) {}
+    start_ticks = systime_now();
+    unsigned long start_cycles = hal_cycles();
+    systime_wait_until(start_ticks + SYSTIME_TICKS_PER_MS);
+    return hal_cycles() - start_cycles;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/* File: hoop_sensor.c
+ * -------------
+ * Interrupt-side capture and main-loop fusion of a hoop's two IR sensors, see hoop_sensor.h.
+ */
+
+#include "hoop_sensor.h"
+#include "gpio_interrupt.h"
+#include "ir_trace.h"
+#include "irq_stats.h"
+#include "dlog.h"
+
+#define QUEUE_MASK (HOOP_SENSOR_QUEUE_LEN - 1)
+
+// Both edges of either beam. Only timestamps and queues the edge, the queue has a single
+// producer (the GPIO port's handlers do not nest) and a single consumer (hoop_sensor_poll).
+static void handle_edge(void *aux_data) {
+    systime_t now = systime_now();
+    hoop_beam_t *beam = (hoop_beam_t *)aux_data;
+    hoop_sensor_t *hs = beam->hoop;
+    gpio_interrupt_clear(beam->pin);
+
+    if (!systime_reached(now, hs->settle_until)) return;
+    int level = gpio_read(beam->pin);
+    ir_trace_record(hs->index * 2 + beam->which, level, now); //does nothing unless a trace is running
+
+    if (hs->tail - hs->head == HOOP_SENSOR_QUEUE_LEN) {
+        hs->dropped++;
+        DLOG("hoop %d: edge queue full, %d edges dropped\n", hs->index + 1, hs->dropped);
+        return;
+    }
+    unsigned int slot = hs->tail & QUEUE_MASK;
+    hs->edges[slot].ticks = now;
+    hs->edges[slot].which = beam->which;
+    hs->edges[slot].level = level;
+    hs->tail++;
+}
+
+void hoop_sensor_init(hoop_sensor_t *hs, gpio_id_t top, gpio_id_t bottom, int index) {
+    hs->index = index;
+    hs->head = hs->tail = hs->dropped = 0;
+    scoring_fusion_reset(&hs->fusion);
+    hs->settle_until = systime_deadline_ms(HOOP_SENSOR_SETTLE_MS);
+
+    gpio_id_t pins[2] = {[SCORING_TOP] = top, [SCORING_BOTTOM] = bottom};
+    for (int i = 0; i < 2; i++) {
+        hoop_beam_t *beam = &hs->beams[i];
+        beam->hoop = hs;
+        beam->pin = pins[i];
+        beam->which = i;
+        gpio_set_input(beam->pin);
+        gpio_interrupt_config(beam->pin, GPIO_INTERRUPT_DOUBLE_EDGE, true);
+        irq_stats_gpio_register_handler(beam->pin, handle_edge, beam, i == SCORING_TOP ? "hoop top" : "hoop bottom");
+        gpio_interrupt_enable(beam->pin);
+    }
+}
+
+void hoop_sensor_disable(hoop_sensor_t *hs) {
+    for (int i = 0; i < 2; i++) {
+        gpio_interrupt_disable(hs->beams[i].pin);
+    }
+}
+
+void hoop_sensor_discard(hoop_sensor_t *hs) {
+    hs->head = hs->tail;
+    scoring_fusion_reset(&hs->fusion);
+}
+
+bool hoop_sensor_poll(hoop_sensor_t *hs, scoring_shot_t *shot) {
+    systime_t now = systime_now(); // before draining, so no edge queued after it is missed
+    while (hs->head != hs->tail) {
+        unsigned int slot = hs->head & QUEUE_MASK;
+        systime_t ticks = hs->edges[slot].ticks;
+        scoring_sensor_t which = hs->edges[slot].which;
+        int level = hs->edges[slot].level;
+
+        // a transit that timed out before this edge finishes first, the edge stays queued
+        if (scoring_fuse_timeout(&hs->fusion, ticks, shot)) return true;
+        hs->head++;
+        if (scoring_fuse_edge(&hs->fusion, which, level, ticks, shot)) return true;
+    }
+    return scoring_fuse_timeout(&hs->fusion, now, shot);
+}
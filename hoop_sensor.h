@@ -0,0 +1,48 @@
+/* File: hoop_sensor.h
+ * -------------
+ * The two IR sensors of one hoop. The interrupt handlers only timestamp each edge and queue
+ * it, hoop_sensor_poll runs the queued edges through the transit fusion in scoring.c from
+ * the main loop and hands back finished transits, scored or rejected.
+ */
+#ifndef _HOOP_SENSOR_H
+#define _HOOP_SENSOR_H
+
+#include "gpio.h"
+#include "scoring.h"
+
+#define HOOP_SENSOR_QUEUE_LEN 32 // edges, power of two
+#define HOOP_SENSOR_SETTLE_MS 200 // the receivers report a spurious edge as they power up
+
+typedef struct hoop_sensor hoop_sensor_t;
+
+typedef struct {
+    hoop_sensor_t *hoop;
+    gpio_id_t pin;
+    scoring_sensor_t which;
+} hoop_beam_t;
+
+struct hoop_sensor {
+    hoop_beam_t beams[2]; // indexed by scoring_sensor_t, aux data of the handlers
+    int index;            // hoop number, names the sensors' ir_trace channels
+    systime_t settle_until;
+    struct {
+        systime_t ticks;
+        uint8_t which, level;
+    } edges[HOOP_SENSOR_QUEUE_LEN];
+    volatile unsigned int head, tail; // tail written by the handlers, head by hoop_sensor_poll
+    volatile unsigned int dropped;
+    scoring_fusion_t fusion;
+};
+
+// Sets up both pins as inputs with edge interrupts, needs gpio_interrupt_init first
+void hoop_sensor_init(hoop_sensor_t *hs, gpio_id_t top, gpio_id_t bottom, int index);
+
+void hoop_sensor_disable(hoop_sensor_t *hs);
+
+// drops queued edges and any half-finished transit
+void hoop_sensor_discard(hoop_sensor_t *hs);
+
+// Returns true with the next finished transit in *shot, false once there is none
+bool hoop_sensor_poll(hoop_sensor_t *hs, scoring_shot_t *shot);
+
+#endif
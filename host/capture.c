@@ -0,0 +1,149 @@
+/* File: capture.c
+ * -------------
+ * Host program that runs the drivers against the mock peripherals: a TM1637 display
+ * (blocking and timer driven), both LED strips and a melody. For each it reports how long
+ * the bus was busy in virtual time and how much host CPU the driver code took, then writes
+ * every pin change to a VCD file for a waveform viewer.
+ *
+ *     make host && ./host/capture drivers.vcd
+ */
+
+#include "mock.h"
+#include "Display.h"
+#include "dotstar.h"
+#include "irq_stats.h"
+#include "evtrace.h"
+#include "sound.h"
+#include "uart_tx.h"
+#include <stdio.h>
+#include <time.h>
+
+#define DISPLAY_CLK GPIO_PG13
+#define DISPLAY_DIO GPIO_PG12
+#define STRIP2_MOSI GPIO_PC1
+#define STRIP2_SCLK GPIO_PD15
+#define BUZZER GPIO_PD21
+#define NLEDS 60
+
+// Plays the TM1637 side of the bus: DIO idles high through its pull-up, and the chip
+// pulls it low for the ninth clock of every byte.
+static struct {
+    int clk;
+    int falls; // falling clock edges since the start condition or the last ACK
+    bool active;
+} tm1637 = {.clk = 1};
+
+static void tm1637_watch(gpio_id_t pin, int val) {
+    if (pin == DISPLAY_CLK) {
+        tm1637.clk = val;
+        if (val || !tm1637.active) return;
+        tm1637.falls++;
+        if (tm1637.falls == 9) { // the start condition's edge and eight data bits
+            mock_set_input(DISPLAY_DIO, 0); // ACK
+        } else if (tm1637.falls == 10) {
+            mock_set_input(DISPLAY_DIO, 1);
+            tm1637.falls = 1; // the next byte follows without a start condition
+        }
+    } else if (pin == DISPLAY_DIO && tm1637.clk) {
+        tm1637.active = !val; // start is DIO falling while CLK is high, stop is DIO rising
+        tm1637.falls = 0;
+    }
+}
+
+static struct {
+    uint64_t bus_ns;
+    struct timespec cpu;
+    int transitions;
+} mark;
+
+static void begin(void) {
+    mark.bus_ns = mock_now_ns();
+    mark.transitions = mock_gpio_transitions();
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &mark.cpu);
+}
+
+static void report(const char *label) {
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    double cpu_us = (now.tv_sec - mark.cpu.tv_sec) * 1e6 + (now.tv_nsec - mark.cpu.tv_nsec) / 1e3;
+    printf("%-36s bus %11.1f us   host cpu %9.1f us   %6d pin changes\n", label,
+           (mock_now_ns() - mark.bus_ns) / 1e3, cpu_us, mock_gpio_transitions() - mark.transitions);
+}
+
+static void idle_while(bool (*busy)(void)) {
+    while (busy()) {
+        mock_advance_ns(1000);
+    }
+}
+
+static bool strip1_busy(void) {
+    return dotstar_busy();
+}
+
+#define NOTE(note, note_time, octave) TONE(note, note_time, octave, 300)
+static const tone_t tones[] = {
+    NOTE(B, 1, 5), NOTE(E, 1, 6), NOTE(A, 4, 6),
+};
+static const melody_t melody = {tones, sizeof(tones) / sizeof(tones[0])};
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "drivers.vcd";
+    DisplayConfig display;
+    led_strip strip2;
+
+    gpio_init();
+    timer_init();
+    interrupts_init();
+    mock_gpio_watch(tm1637_watch);
+    mock_set_input(DISPLAY_DIO, 1); // pull-up
+
+    begin();
+    display_init(&display, DISPLAY_CLK, DISPLAY_DIO, DISPLAY_BITDELAY_AUTO);
+    report("TM1637 init + bit delay calibration");
+    printf("    calibrated bit delay %u us\n", display.bitDelay);
+
+    begin();
+    display_num(&display, 1234);
+    report("TM1637 display_num, blocking");
+
+    begin();
+    spi2_init(&strip2, STRIP2_MOSI, STRIP2_SCLK);
+    report("strip 2 init (measures CPU clock)");
+
+    begin();
+    display_color(&strip2, NLEDS, 0xFF, 0x00, 0x00, true);
+    report("strip 2 60 leds, bit-banged");
+
+    begin();
+    spi_init(SPI_MODE_0, 12000000);
+    dotstar_init(NLEDS);
+    display_color(NULL, NLEDS, 0x00, 0x00, 0xFF, false);
+    report("strip 1 60 leds, DMA start");
+    idle_while(strip1_busy);
+    report("strip 1 60 leds, until sent");
+
+    uart_tx_init();
+    interrupts_global_enable();
+    display_tx_init(HSTIMER0);
+    begin();
+    display_num(&display, 5678);
+    report("TM1637 display_num, queued");
+    idle_while(display_tx_busy);
+    report("TM1637 display_num, until sent");
+
+    sound_init();
+    begin();
+    sound_play(&melody, BUZZER, true);
+    idle_while(sound_is_playing);
+    report("two point melody");
+    irq_stats_dump();
+    evtrace_dump();
+    uart_tx_flush();
+
+    if (!mock_vcd_dump(path)) {
+        printf("cannot write %s\n", path);
+        return 1;
+    }
+    printf("wrote %d pin changes to %s\n", mock_gpio_transitions(), path);
+    return 0;
+}
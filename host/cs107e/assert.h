@@ -0,0 +1,24 @@
+/* File: assert.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory. Only
+ * found by #include "assert.h", the system <assert.h> is untouched. mango_abort comes
+ * from host/mock_interrupts.c.
+ */
+#ifndef _CS107E_ASSERT_H
+#define _CS107E_ASSERT_H
+
+#include "printf.h"
+
+void mango_abort(void);
+
+#define assert(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("File %s, line %d: Assertion '%s' failed\n", __FILE__, __LINE__, #expr); \
+            mango_abort(); \
+        } \
+    } while (0)
+
+#define error(...) do { printf(__VA_ARGS__); mango_abort(); } while (0)
+
+#endif
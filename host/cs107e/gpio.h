@@ -0,0 +1,62 @@
+/* File: gpio.h
+ * -------------
+ * Host build stand-in for the CS107e library header of the same name: the declarations
+ * the drivers and the mocks in host/ use, so make host needs no course library checkout.
+ * Pin ids follow the library, the port number in the upper byte and the pin in the lower.
+ */
+#ifndef _GPIO_H
+#define _GPIO_H
+
+#include <stdbool.h>
+
+enum {
+    GPIO_PORT_A = 0,
+    GPIO_PORT_B,
+    GPIO_PORT_C,
+    GPIO_PORT_D,
+    GPIO_PORT_E,
+    GPIO_PORT_F,
+    GPIO_PORT_G,
+};
+
+#define GPIO_ID(port, num) (((port) << 8) | (num))
+
+typedef enum {
+    GPIO_PB0 = GPIO_ID(GPIO_PORT_B, 0), GPIO_PB1, GPIO_PB2, GPIO_PB3, GPIO_PB4, GPIO_PB5, GPIO_PB6,
+    GPIO_PB7, GPIO_PB8, GPIO_PB9, GPIO_PB10, GPIO_PB11, GPIO_PB12,
+    GPIO_PC0 = GPIO_ID(GPIO_PORT_C, 0), GPIO_PC1, GPIO_PC2, GPIO_PC3, GPIO_PC4, GPIO_PC5, GPIO_PC6, GPIO_PC7,
+    GPIO_PD0 = GPIO_ID(GPIO_PORT_D, 0), GPIO_PD1, GPIO_PD2, GPIO_PD3, GPIO_PD4, GPIO_PD5, GPIO_PD6,
+    GPIO_PD7, GPIO_PD8, GPIO_PD9, GPIO_PD10, GPIO_PD11, GPIO_PD12, GPIO_PD13, GPIO_PD14, GPIO_PD15,
+    GPIO_PD16, GPIO_PD17, GPIO_PD18, GPIO_PD19, GPIO_PD20, GPIO_PD21, GPIO_PD22,
+    GPIO_PE0 = GPIO_ID(GPIO_PORT_E, 0), GPIO_PE1, GPIO_PE2, GPIO_PE3, GPIO_PE4, GPIO_PE5, GPIO_PE6,
+    GPIO_PE7, GPIO_PE8, GPIO_PE9, GPIO_PE10, GPIO_PE11, GPIO_PE12, GPIO_PE13, GPIO_PE14, GPIO_PE15,
+    GPIO_PE16, GPIO_PE17,
+    GPIO_PF0 = GPIO_ID(GPIO_PORT_F, 0), GPIO_PF1, GPIO_PF2, GPIO_PF3, GPIO_PF4, GPIO_PF5, GPIO_PF6,
+    GPIO_PG0 = GPIO_ID(GPIO_PORT_G, 0), GPIO_PG1, GPIO_PG2, GPIO_PG3, GPIO_PG4, GPIO_PG5, GPIO_PG6,
+    GPIO_PG7, GPIO_PG8, GPIO_PG9, GPIO_PG10, GPIO_PG11, GPIO_PG12, GPIO_PG13, GPIO_PG14, GPIO_PG15,
+    GPIO_PG16, GPIO_PG17, GPIO_PG18,
+} gpio_id_t;
+
+enum {
+    GPIO_FN_INPUT = 0,
+    GPIO_FN_OUTPUT = 1,
+    GPIO_FN_ALT2 = 2,
+    GPIO_FN_ALT3 = 3,
+    GPIO_FN_ALT4 = 4,
+    GPIO_FN_ALT5 = 5,
+    GPIO_FN_ALT6 = 6,
+    GPIO_FN_ALT7 = 7,
+    GPIO_FN_ALT8 = 8,
+    GPIO_FN_INTERRUPT = 14,
+    GPIO_FN_DISABLED = 15,
+};
+
+void gpio_init(void);
+void gpio_set_function(gpio_id_t pin, unsigned int function);
+unsigned int gpio_get_function(gpio_id_t pin);
+void gpio_set_input(gpio_id_t pin);
+void gpio_set_output(gpio_id_t pin);
+void gpio_write(gpio_id_t pin, int val);
+int gpio_read(gpio_id_t pin);
+
+#endif
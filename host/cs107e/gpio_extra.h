@@ -0,0 +1,14 @@
+/* File: gpio_extra.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory.
+ */
+#ifndef _GPIO_EXTRA_H
+#define _GPIO_EXTRA_H
+
+#include "gpio.h"
+
+void gpio_set_pullup(gpio_id_t pin);
+void gpio_set_pulldown(gpio_id_t pin);
+void gpio_set_pullnone(gpio_id_t pin);
+
+#endif
@@ -0,0 +1,26 @@
+/* File: gpio_interrupt.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory.
+ */
+#ifndef _GPIO_INTERRUPT_H
+#define _GPIO_INTERRUPT_H
+
+#include "gpio.h"
+#include "interrupts.h"
+
+typedef enum gpio_interrupt_mode {
+    GPIO_INTERRUPT_POSITIVE_EDGE = 0,
+    GPIO_INTERRUPT_NEGATIVE_EDGE,
+    GPIO_INTERRUPT_HIGH_LEVEL,
+    GPIO_INTERRUPT_LOW_LEVEL,
+    GPIO_INTERRUPT_DOUBLE_EDGE,
+} gpio_event_t;
+
+void gpio_interrupt_init(void);
+void gpio_interrupt_config(gpio_id_t pin, gpio_event_t event, bool debounce);
+void gpio_interrupt_register_handler(gpio_id_t pin, handlerfn_t fn, void *aux_data);
+void gpio_interrupt_enable(gpio_id_t pin);
+void gpio_interrupt_disable(gpio_id_t pin);
+void gpio_interrupt_clear(gpio_id_t pin);
+
+#endif
@@ -0,0 +1,18 @@
+/* File: hstimer.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory.
+ */
+#ifndef _HSTIMER_H
+#define _HSTIMER_H
+
+typedef enum {
+    HSTIMER0 = 0,
+    HSTIMER1,
+} hstimer_id_t;
+
+void hstimer_init(hstimer_id_t timer, long usecs);
+void hstimer_enable(hstimer_id_t timer);
+void hstimer_disable(hstimer_id_t timer);
+void hstimer_interrupt_clear(hstimer_id_t timer);
+
+#endif
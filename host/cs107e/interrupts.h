@@ -0,0 +1,35 @@
+/* File: interrupts.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory. Only
+ * the interrupt sources the drivers use are listed, numbered as on the D1.
+ */
+#ifndef _INTERRUPTS_H
+#define _INTERRUPTS_H
+
+#include <stdbool.h>
+
+typedef void (*handlerfn_t)(void *aux_data);
+
+typedef enum {
+    INTERRUPT_SOURCE_UART0 = 18,
+    INTERRUPT_SOURCE_SPI0 = 31,
+    INTERRUPT_SOURCE_SPI1 = 32,
+    INTERRUPT_SOURCE_DMA = 66,
+    INTERRUPT_SOURCE_HSTIMER0 = 71,
+    INTERRUPT_SOURCE_HSTIMER1 = 72,
+    INTERRUPT_SOURCE_GPIOB = 85,
+    INTERRUPT_SOURCE_GPIOC = 87,
+    INTERRUPT_SOURCE_GPIOD = 89,
+    INTERRUPT_SOURCE_GPIOE = 91,
+    INTERRUPT_SOURCE_GPIOF = 93,
+    INTERRUPT_SOURCE_GPIOG = 95,
+} interrupt_source_t;
+
+void interrupts_init(void);
+void interrupts_global_enable(void);
+void interrupts_global_disable(void);
+void interrupts_enable_source(interrupt_source_t source);
+void interrupts_disable_source(interrupt_source_t source);
+void interrupts_register_handler(interrupt_source_t source, handlerfn_t fn, void *aux_data);
+
+#endif
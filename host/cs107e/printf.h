@@ -0,0 +1,16 @@
+/* File: printf.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory. The
+ * C library provides these on the host.
+ */
+#ifndef _PRINTF_H
+#define _PRINTF_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+int printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+int snprintf(char *buf, size_t bufsize, const char *format, ...) __attribute__((format(printf, 3, 4)));
+int vsnprintf(char *buf, size_t bufsize, const char *format, va_list args) __attribute__((format(printf, 3, 0)));
+
+#endif
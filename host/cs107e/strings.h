@@ -0,0 +1,17 @@
+/* File: strings.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory. The
+ * C library provides these on the host. Only found by #include "strings.h", the system
+ * <strings.h> is untouched.
+ */
+#ifndef _CS107E_STRINGS_H
+#define _CS107E_STRINGS_H
+
+#include <stddef.h>
+
+void *memcpy(void *dst, const void *src, size_t n);
+void *memset(void *dst, int val, size_t n);
+size_t strlen(const char *str);
+int strcmp(const char *s1, const char *s2);
+
+#endif
@@ -0,0 +1,14 @@
+/* File: timer.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory.
+ */
+#ifndef _TIMER_H
+#define _TIMER_H
+
+void timer_init(void);
+unsigned long timer_get_ticks(void);
+void timer_delay_us(int usecs);
+void timer_delay_ms(int msecs);
+void timer_delay(int secs);
+
+#endif
@@ -0,0 +1,12 @@
+/* File: uart.h
+ * -------------
+ * Host build stand-in for the CS107e library header, see gpio.h in this directory.
+ */
+#ifndef _UART_H
+#define _UART_H
+
+void uart_init(void);
+int uart_putchar(int ch);
+void uart_putstring(const char *str);
+
+#endif
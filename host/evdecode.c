@@ -0,0 +1,174 @@
+/* File: evdecode.c
+ * -------------
+ * Decodes the event trace frame that evtrace_dump prints (see evtrace.h) into a text
+ * timeline, and optionally a Chrome trace to open in chrome://tracing or ui.perfetto.dev.
+ * The input is the uart log, everything outside the EVTRACE markers is skipped.
+ *
+ *     ./host/evdecode [-j trace.json] game.log
+ */
+
+#include "evtrace.h"
+#include "scoring.h"
+#include "teams.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_BYTES (EVTRACE_HEADER_BYTES + EVTRACE_LEN * 16 + 4)
+
+static uint8_t frame[MAX_BYTES];
+static int frame_len;
+
+#define TEAM(id, name, red, green, blue) [id] = name,
+static const char *const team_names[NUM_TEAMS] = {TEAM_LIST};
+#undef TEAM
+
+static const char *team_name(int team) {
+    static char other[16];
+    if (team < NUM_TEAMS) return team_names[team];
+    snprintf(other, sizeof(other), "team %d", team);
+    return other;
+}
+
+// one timeline row per subsystem in the Chrome trace
+static const char *const lanes[] = {"", "shots", "scores", "teams", "displays", "leds", "sound"};
+
+static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Reads the hex between the EVTRACE markers of a uart log
+static bool load(FILE *fp) {
+    char line[256];
+    int declared = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (declared < 0) {
+            if (sscanf(line, "EVTRACE 1 %d", &declared) != 1) declared = -1;
+            continue;
+        }
+        if (strncmp(line, "EVTRACE END", 11) == 0) break;
+        for (char *p = line; p[0] && p[1] && frame_len < MAX_BYTES; p += 2) {
+            unsigned int byte;
+            if (sscanf(p, "%2x", &byte) != 1) break;
+            frame[frame_len++] = byte;
+        }
+    }
+    if (declared < 0 || frame_len != declared || frame_len < EVTRACE_HEADER_BYTES + 4) return false;
+    if (memcmp(frame, "EVT1", 4) != 0 || frame_len != EVTRACE_HEADER_BYTES + (int)get_u32(frame + 4) * 16 + 4) {
+        return false;
+    }
+    uint32_t crc = ~evtrace_crc32_update(EVTRACE_CRC_INIT, frame, frame_len - 4);
+    if (crc != get_u32(frame + frame_len - 4)) {
+        fprintf(stderr, "event trace CRC mismatch\n");
+        return false;
+    }
+    return true;
+}
+
+static evtrace_event_t event_at(int i) {
+    const uint8_t *p = frame + EVTRACE_HEADER_BYTES + 16 * i;
+    evtrace_event_t ev;
+    ev.ticks = get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+    ev.type = p[8];
+    ev.a = p[9];
+    ev.b = p[10] | p[11] << 8;
+    ev.c = get_u32(p + 12);
+    return ev;
+}
+
+// Describes an event as its name plus a text line and the JSON args for the Chrome trace
+static const char *describe(const evtrace_event_t *ev, char *text, char *args, size_t size) {
+    const double tpms = SYSTIME_TICKS_PER_MS;
+    switch (ev->type) {
+    case EVT_SHOT:
+        snprintf(text, size, "hoop %d %s, %d points, transit %.1f ms", ev->a + 1,
+                 scoring_result_name(ev->b >> 8), ev->b & 0xff, ev->c / tpms);
+        snprintf(args, size, "{\"hoop\": %d, \"result\": \"%s\", \"points\": %d, \"transit_ms\": %.3f}", ev->a + 1,
+                 scoring_result_name(ev->b >> 8), ev->b & 0xff, ev->c / tpms);
+        return "shot";
+    case EVT_SCORE:
+        snprintf(text, size, "%s score %u", team_name(ev->a), ev->c);
+        snprintf(args, size, "{\"team\": \"%s\", \"score\": %u}", team_name(ev->a), ev->c);
+        return "score";
+    case EVT_TEAM_SWAP: {
+        int tlen = snprintf(text, size, "now"), alen = snprintf(args, size, "{");
+        for (int hoop = 0; hoop < ev->a && hoop < 8; hoop++) {
+            const char *team = team_name((ev->c >> (4 * hoop)) & 0xf);
+            tlen += snprintf(text + tlen, size - tlen, "%s hoop %d %s", hoop ? "," : "", hoop + 1, team);
+            alen += snprintf(args + alen, size - alen, "%s\"hoop%d\": \"%s\"", hoop ? ", " : "", hoop + 1, team);
+        }
+        snprintf(args + alen, size - alen, "}");
+        return "team swap";
+    }
+    case EVT_DISPLAY_FRAME:
+        snprintf(text, size, "display on clock pin %u, %d byte frame %02x %02x", ev->b, ev->a, ev->c & 0xff, (ev->c >> 8) & 0xff);
+        snprintf(args, size, "{\"clock_pin\": %u, \"len\": %d, \"bytes\": \"%02x %02x\"}", ev->b, ev->a,
+                 ev->c & 0xff, (ev->c >> 8) & 0xff);
+        return "display frame";
+    case EVT_LED_FRAME:
+        snprintf(text, size, "%u leds per strip", ev->c);
+        snprintf(args, size, "{\"leds\": %u}", ev->c);
+        return "led frame";
+    case EVT_NOTE_START:
+        if (ev->c) snprintf(text, size, "note %d, %.1f Hz", ev->a, SYSTIME_TICKS_PER_SEC / (2.0 * ev->c));
+        else snprintf(text, size, "note %d, rest", ev->a);
+        snprintf(args, size, "{\"index\": %d, \"half_period_ticks\": %u}", ev->a, ev->c);
+        return "note";
+    default:
+        snprintf(text, size, "type %d: %d %u %u", ev->type, ev->a, ev->b, ev->c);
+        snprintf(args, size, "{}");
+        return "unknown";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *json_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:")) != -1) {
+        if (opt == 'j') json_path = optarg;
+        else {
+            fprintf(stderr, "usage: %s [-j trace.json] game.log\n", argv[0]);
+            return 1;
+        }
+    }
+    FILE *fp = (optind < argc) ? fopen(argv[optind], "r") : stdin;
+    if (!fp || !load(fp)) {
+        fprintf(stderr, "no event trace found\n");
+        return 1;
+    }
+    FILE *json = NULL;
+    if (json_path && !(json = fopen(json_path, "w"))) {
+        fprintf(stderr, "cannot write %s\n", json_path);
+        return 1;
+    }
+
+    int n = get_u32(frame + 4);
+    printf("%d events, %u older ones overwritten\n", n, get_u32(frame + 8));
+    if (json) {
+        fprintf(json, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        for (int lane = 1; lane < (int)(sizeof(lanes) / sizeof(lanes[0])); lane++) {
+            fprintf(json, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                    lane > 1 ? ",\n" : "", lane, lanes[lane]);
+        }
+    }
+
+    uint64_t t0 = n ? event_at(0).ticks : 0;
+    for (int i = 0; i < n; i++) {
+        evtrace_event_t ev = event_at(i);
+        char text[256], args[256];
+        const char *name = describe(&ev, text, args, sizeof(text));
+        double us = (ev.ticks - t0) / (double)SYSTIME_TICKS_PER_US;
+        printf("%12.6f s  %-13s %s\n", us / 1e6, name, text);
+        if (json) {
+            int lane = ev.type < sizeof(lanes) / sizeof(lanes[0]) ? ev.type : 0;
+            fprintf(json, ",\n{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": %s}",
+                    name, us, lane, args);
+        }
+    }
+    if (json) {
+        fprintf(json, "\n]}\n");
+        fclose(json);
+    }
+    return 0;
+}
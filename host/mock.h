@@ -0,0 +1,51 @@
+/* File: mock.h
+ * -------------
+ * Control side of the host mock peripherals. The mocks implement the CS107e library calls
+ * the drivers make (gpio, timer, hstimer, interrupts, gpio_interrupt, uart) plus hal.h and
+ * spi.h, on top of a virtual clock in nanoseconds. Time only moves when the code under
+ * test reads the clock, delays or waits, each clock read costs MOCK_POLL_NS. Timer and
+ * gpio interrupts fire as virtual time passes their deadline, never nested.
+ */
+#ifndef _MOCK_H
+#define _MOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpio.h"
+#include "interrupts.h"
+
+#define MOCK_POLL_NS 5           // virtual cost of one clock read
+#define MOCK_CPU_HZ 1008000000UL // what hal_cycles counts at
+
+typedef void (*mock_event_fn_t)(void *aux_data);
+
+uint64_t mock_now_ns(void);
+
+// moves virtual time forward, firing any interrupts that come due on the way
+void mock_advance_ns(uint64_t ns);
+
+// runs fn from interrupt context once virtual time reaches at_ns
+void mock_schedule(uint64_t at_ns, mock_event_fn_t fn, void *aux_data);
+
+// called by the mock peripherals to request an interrupt from source
+void mock_raise(interrupt_source_t source);
+
+// drives an input pin from outside, as a sensor or an ACKing chip would
+void mock_set_input(gpio_id_t pin, int val);
+
+// Records a change of pin at a given time without touching the live pin state, used
+// for waveforms that play out in the background (SPI1)
+void mock_gpio_log(gpio_id_t pin, int val, uint64_t at_ns);
+
+// Called on every change of a pin's level, lets a tool model the chip on the other end
+typedef void (*mock_watch_fn_t)(gpio_id_t pin, int val);
+
+void mock_gpio_watch(mock_watch_fn_t fn);
+
+// number of recorded pin changes so far
+int mock_gpio_transitions(void);
+
+// writes every recorded pin change as a VCD waveform, returns false if path can't be written
+bool mock_vcd_dump(const char *path);
+
+#endif
@@ -0,0 +1,137 @@
+/* File: mock_clock.c
+ * -------------
+ * Virtual clock behind timer.h, hstimer.h and hal_cycles, plus the queue of scheduled
+ * events that stand in for peripherals finishing in the background.
+ */
+
+#include "mock.h"
+#include "timer.h"
+#include "hstimer.h"
+#include "hal.h"
+
+#define NHSTIMERS 2
+#define MAX_EVENTS 8
+
+static uint64_t now_ns;
+
+static struct {
+    uint64_t period_ns;
+    uint64_t next_ns;
+    bool enabled;
+} hstimers[NHSTIMERS];
+
+static struct {
+    uint64_t at_ns;
+    mock_event_fn_t fn;
+    void *aux_data;
+    bool pending;
+} events[MAX_EVENTS];
+
+uint64_t mock_now_ns(void) {
+    return now_ns;
+}
+
+void mock_schedule(uint64_t at_ns, mock_event_fn_t fn, void *aux_data) {
+    for (int i = 0; i < MAX_EVENTS; i++) {
+        if (!events[i].pending) {
+            events[i].at_ns = at_ns;
+            events[i].fn = fn;
+            events[i].aux_data = aux_data;
+            events[i].pending = true;
+            return;
+        }
+    }
+}
+
+// Finds the earliest hstimer deadline or scheduled event at or before limit, returns
+// false if there is none. *which is the timer id, or NHSTIMERS + event index.
+static bool next_due(uint64_t limit, int *which, uint64_t *at) {
+    bool found = false;
+    for (int i = 0; i < NHSTIMERS; i++) {
+        if (hstimers[i].enabled && hstimers[i].next_ns <= limit && (!found || hstimers[i].next_ns < *at)) {
+            *which = i, *at = hstimers[i].next_ns, found = true;
+        }
+    }
+    for (int i = 0; i < MAX_EVENTS; i++) {
+        if (events[i].pending && events[i].at_ns <= limit && (!found || events[i].at_ns < *at)) {
+            *which = NHSTIMERS + i, *at = events[i].at_ns, found = true;
+        }
+    }
+    return found;
+}
+
+void mock_advance_ns(uint64_t ns) {
+    static bool advancing; // handlers read the clock too, their time just accrues
+    uint64_t target = now_ns + ns;
+    int which;
+    uint64_t at = 0;
+
+    if (advancing) {
+        now_ns = target;
+        return;
+    }
+    advancing = true;
+    while (next_due(target, &which, &at)) {
+        if (at > now_ns) now_ns = at;
+        if (which < NHSTIMERS) {
+            hstimers[which].next_ns += hstimers[which].period_ns;
+            mock_raise(which == HSTIMER0 ? INTERRUPT_SOURCE_HSTIMER0 : INTERRUPT_SOURCE_HSTIMER1);
+        } else {
+            events[which - NHSTIMERS].pending = false;
+            events[which - NHSTIMERS].fn(events[which - NHSTIMERS].aux_data);
+        }
+        if (now_ns > target) target = now_ns; // handler ran past the target
+    }
+    now_ns = target;
+    advancing = false;
+}
+
+void timer_init(void) {}
+
+unsigned long timer_get_ticks(void) {
+    mock_advance_ns(MOCK_POLL_NS);
+    return now_ns * 24 / 1000;
+}
+
+void timer_delay_us(int usec) {
+    mock_advance_ns(usec * 1000ULL);
+}
+
+void timer_delay_ms(int msec) {
+    mock_advance_ns(msec * 1000000ULL);
+}
+
+void timer_delay(int sec) {
+    mock_advance_ns(sec * 1000000000ULL);
+}
+
+unsigned long hal_cycles(void) {
+    mock_advance_ns(MOCK_POLL_NS);
+    return now_ns * (MOCK_CPU_HZ / 1000000) / 1000;
+}
+
+void hstimer_init(hstimer_id_t timer, long usecs) {
+    hstimers[timer].period_ns = (usecs > 0 ? usecs : 1) * 1000ULL;
+    hstimers[timer].enabled = false;
+}
+
+void hal_hstimer_set_interval(int timer, uint32_t ticks) {
+    hstimers[timer].period_ns = ticks ? ticks * 125ULL / 3 : 1; // 1000 / 24 ns per tick
+    hstimers[timer].next_ns = now_ns + hstimers[timer].period_ns; // the reload
+}
+
+// the counter reloads when the timer fires, 5 ns per 200 MHz clock
+uint32_t hal_hstimer_elapsed(int timer) {
+    return (now_ns - (hstimers[timer].next_ns - hstimers[timer].period_ns)) / 5;
+}
+
+void hstimer_enable(hstimer_id_t timer) {
+    hstimers[timer].next_ns = now_ns + hstimers[timer].period_ns;
+    hstimers[timer].enabled = true;
+}
+
+void hstimer_disable(hstimer_id_t timer) {
+    hstimers[timer].enabled = false;
+}
+
+void hstimer_interrupt_clear(hstimer_id_t timer) {}
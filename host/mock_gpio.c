@@ -0,0 +1,220 @@
+/* File: mock_gpio.c
+ * -------------
+ * GPIO ports for the host build: gpio.h, gpio_extra.h, gpio_interrupt.h and the hal.h
+ * register accessors. Pins read back what they drive when output and what mock_set_input
+ * last put on them when input. Every change of a pin's level is logged with its virtual
+ * time for mock_vcd_dump.
+ */
+
+#include "mock.h"
+#include "hal.h"
+#include "gpio_extra.h"
+#include "gpio_interrupt.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NPORTS 7
+#define PORT_OF(pin)  ((unsigned int)(pin) >> 8)
+#define INDEX_OF(pin) ((unsigned int)(pin) & 0xff)
+
+static struct {
+    uint32_t dat;
+    uint32_t cfg[4];
+    uint32_t input; // level put on input pins from outside
+} ports[NPORTS];
+
+typedef struct {
+    uint64_t at_ns;
+    uint32_t seq; // log order, breaks ties between equal times
+    uint16_t pin;
+    uint8_t val;
+} transition_t;
+
+static struct {
+    transition_t *entries;
+    int count, capacity;
+    uint32_t seen[NPORTS]; // pins that appear in the log
+} log_;
+
+static mock_watch_fn_t watcher;
+
+static struct {
+    handlerfn_t fn;
+    void *aux_data;
+    enum gpio_interrupt_mode mode;
+    bool enabled;
+} pin_irqs[NPORTS][32];
+
+void mock_gpio_log(gpio_id_t pin, int val, uint64_t at_ns) {
+    if (log_.count == log_.capacity) {
+        log_.capacity = log_.capacity ? 2 * log_.capacity : 4096;
+        log_.entries = realloc(log_.entries, log_.capacity * sizeof(transition_t));
+        if (!log_.entries) abort();
+    }
+    log_.entries[log_.count] = (transition_t){at_ns, log_.count, pin, val};
+    log_.count++;
+    log_.seen[PORT_OF(pin)] |= 1u << INDEX_OF(pin);
+}
+
+void mock_gpio_watch(mock_watch_fn_t fn) {
+    watcher = fn;
+}
+
+int mock_gpio_transitions(void) {
+    return log_.count;
+}
+
+static bool is_output(unsigned int port, unsigned int index) {
+    return ((ports[port].cfg[index / 8] >> ((index % 8) * 4)) & 0xf) != GPIO_FN_INPUT;
+}
+
+// the level every pin of a port is at, driven or not
+static uint32_t levels(unsigned int port) {
+    uint32_t out_mask = 0;
+    for (unsigned int i = 0; i < 32; i++) {
+        if (is_output(port, i)) out_mask |= 1u << i;
+    }
+    return (ports[port].dat & out_mask) | (ports[port].input & ~out_mask);
+}
+
+// Logs pins whose level moved from before, and raises interrupts on input edges
+static void note_changes(unsigned int port, uint32_t before) {
+    uint32_t after = levels(port), changed = before ^ after;
+    for (unsigned int i = 0; i < 32; i++) {
+        if (!(changed & (1u << i))) continue;
+        int val = (after >> i) & 1;
+        mock_gpio_log((gpio_id_t)((port << 8) | i), val, mock_now_ns());
+        if (watcher) watcher((gpio_id_t)((port << 8) | i), val);
+
+        if (!pin_irqs[port][i].enabled || is_output(port, i)) continue;
+        enum gpio_interrupt_mode mode = pin_irqs[port][i].mode;
+        if (mode == GPIO_INTERRUPT_DOUBLE_EDGE || (mode == GPIO_INTERRUPT_POSITIVE_EDGE && val)
+            || (mode == GPIO_INTERRUPT_NEGATIVE_EDGE && !val)) {
+            pin_irqs[port][i].fn(pin_irqs[port][i].aux_data); // the library dispatches per pin
+        }
+    }
+}
+
+uint32_t hal_gpio_dat_read(unsigned int port) {
+    return levels(port);
+}
+
+void hal_gpio_dat_write(unsigned int port, uint32_t val) {
+    uint32_t before = levels(port);
+    ports[port].dat = val;
+    note_changes(port, before);
+}
+
+uint32_t hal_gpio_cfg_read(unsigned int port, int reg) {
+    return ports[port].cfg[reg];
+}
+
+void hal_gpio_cfg_write(unsigned int port, int reg, uint32_t val) {
+    uint32_t before = levels(port);
+    ports[port].cfg[reg] = val;
+    note_changes(port, before);
+}
+
+void mock_set_input(gpio_id_t pin, int val) {
+    unsigned int port = PORT_OF(pin);
+    uint32_t before = levels(port);
+    if (val) ports[port].input |= 1u << INDEX_OF(pin);
+    else     ports[port].input &= ~(1u << INDEX_OF(pin));
+    note_changes(port, before);
+}
+
+void gpio_init(void) {}
+
+void gpio_set_function(gpio_id_t pin, unsigned int function) {
+    unsigned int port = PORT_OF(pin), index = INDEX_OF(pin), shift = (index % 8) * 4;
+    uint32_t cfg = hal_gpio_cfg_read(port, index / 8);
+    hal_gpio_cfg_write(port, index / 8, (cfg & ~(0xfu << shift)) | ((function & 0xf) << shift));
+}
+
+unsigned int gpio_get_function(gpio_id_t pin) {
+    unsigned int port = PORT_OF(pin), index = INDEX_OF(pin);
+    return (ports[port].cfg[index / 8] >> ((index % 8) * 4)) & 0xf;
+}
+
+void gpio_set_input(gpio_id_t pin) {
+    gpio_set_function(pin, GPIO_FN_INPUT);
+}
+
+void gpio_set_output(gpio_id_t pin) {
+    gpio_set_function(pin, GPIO_FN_OUTPUT);
+}
+
+void gpio_write(gpio_id_t pin, int val) {
+    unsigned int port = PORT_OF(pin);
+    uint32_t bit = 1u << INDEX_OF(pin);
+    hal_gpio_dat_write(port, val ? (ports[port].dat | bit) : (ports[port].dat & ~bit));
+}
+
+int gpio_read(gpio_id_t pin) {
+    return (levels(PORT_OF(pin)) >> INDEX_OF(pin)) & 1;
+}
+
+void gpio_set_pullup(gpio_id_t pin) {}
+void gpio_set_pulldown(gpio_id_t pin) {}
+void gpio_set_pullnone(gpio_id_t pin) {}
+
+void gpio_interrupt_init(void) {}
+
+void gpio_interrupt_config(gpio_id_t pin, enum gpio_interrupt_mode mode, bool debounce) {
+    pin_irqs[PORT_OF(pin)][INDEX_OF(pin)].mode = mode;
+}
+
+void gpio_interrupt_register_handler(gpio_id_t pin, handlerfn_t fn, void *aux_data) {
+    pin_irqs[PORT_OF(pin)][INDEX_OF(pin)].fn = fn;
+    pin_irqs[PORT_OF(pin)][INDEX_OF(pin)].aux_data = aux_data;
+}
+
+void gpio_interrupt_enable(gpio_id_t pin) {
+    pin_irqs[PORT_OF(pin)][INDEX_OF(pin)].enabled = true;
+}
+
+void gpio_interrupt_disable(gpio_id_t pin) {
+    pin_irqs[PORT_OF(pin)][INDEX_OF(pin)].enabled = false;
+}
+
+void gpio_interrupt_clear(gpio_id_t pin) {}
+
+static int by_time(const void *a, const void *b) {
+    const transition_t *x = a, *y = b;
+    if (x->at_ns != y->at_ns) return x->at_ns < y->at_ns ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+bool mock_vcd_dump(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+    // background waveforms are logged ahead of time, so the log is only mostly in order
+    qsort(log_.entries, log_.count, sizeof(transition_t), by_time);
+
+    fprintf(fp, "$timescale 1ns $end\n$scope module mango $end\n");
+    for (unsigned int port = 0; port < NPORTS; port++) {
+        for (unsigned int i = 0; i < 32; i++) {
+            if (log_.seen[port] & (1u << i)) {
+                fprintf(fp, "$var wire 1 p%u_%u P%c%u $end\n", port, i, 'A' + port, i);
+            }
+        }
+    }
+    fprintf(fp, "$upscope $end\n$enddefinitions $end\n$dumpvars\n");
+    for (unsigned int port = 0; port < NPORTS; port++) {
+        for (unsigned int i = 0; i < 32; i++) {
+            if (log_.seen[port] & (1u << i)) fprintf(fp, "xp%u_%u\n", port, i);
+        }
+    }
+    fprintf(fp, "$end\n");
+
+    uint64_t last = UINT64_MAX;
+    for (int i = 0; i < log_.count; i++) {
+        const transition_t *t = &log_.entries[i];
+        if (t->at_ns != last) {
+            last = t->at_ns;
+            fprintf(fp, "#%llu\n", (unsigned long long)last);
+        }
+        fprintf(fp, "%dp%u_%u\n", t->val, PORT_OF(t->pin), INDEX_OF(t->pin));
+    }
+    return fclose(fp) == 0;
+}
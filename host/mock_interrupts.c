@@ -0,0 +1,115 @@
+/* File: mock_interrupts.c
+ * -------------
+ * Interrupt controller and console for the host build. A raised source runs its handler
+ * right away when enabled, otherwise stays pending until it is.
+ */
+
+#include "mock.h"
+#include "hal.h"
+#include "uart.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NSOURCES 256
+
+static struct {
+    handlerfn_t fn;
+    void *aux_data;
+    bool enabled;
+    bool pending;
+} sources[NSOURCES];
+
+static bool global_enabled;
+static bool in_handler;
+
+static void dispatch(void) {
+    if (!global_enabled || in_handler) return;
+    in_handler = true;
+    for (int i = 0; i < NSOURCES; i++) {
+        if (sources[i].pending && sources[i].enabled && sources[i].fn) {
+            sources[i].pending = false;
+            sources[i].fn(sources[i].aux_data);
+        }
+    }
+    in_handler = false;
+}
+
+void mock_raise(interrupt_source_t source) {
+    sources[source].pending = true;
+    dispatch();
+}
+
+void interrupts_init(void) {}
+
+void interrupts_global_enable(void) {
+    global_enabled = true;
+    dispatch();
+}
+
+void interrupts_global_disable(void) {
+    global_enabled = false;
+}
+
+unsigned long hal_irq_save(void) {
+    bool was_enabled = global_enabled;
+    global_enabled = false;
+    return was_enabled;
+}
+
+void hal_irq_restore(unsigned long flags) {
+    if (flags) interrupts_global_enable();
+}
+
+bool hal_irq_enabled(void) {
+    return global_enabled && !in_handler;
+}
+
+void interrupts_enable_source(interrupt_source_t source) {
+    sources[source].enabled = true;
+    dispatch();
+}
+
+void interrupts_disable_source(interrupt_source_t source) {
+    sources[source].enabled = false;
+}
+
+void interrupts_register_handler(interrupt_source_t source, handlerfn_t fn, void *aux_data) {
+    sources[source].fn = fn;
+    sources[source].aux_data = aux_data;
+}
+
+// The console's transmit FIFO never fills on the host, so the transmit-empty interrupt
+// fires whenever it is enabled
+
+bool hal_uart_tx_ready(void) {
+    return true;
+}
+
+bool hal_uart_tx_idle(void) {
+    return true;
+}
+
+void hal_uart_tx_put(uint8_t byte) {
+    putchar(byte);
+}
+
+void hal_uart_tx_irq(bool enable) {
+    if (enable) mock_raise(INTERRUPT_SOURCE_UART0);
+}
+
+void hal_uart_irq_ack(void) {}
+
+void uart_init(void) {}
+
+int uart_putchar(int ch) {
+    return putchar(ch);
+}
+
+void uart_putstring(const char *str) {
+    fputs(str, stdout);
+}
+
+void mango_abort(void) {
+    fflush(stdout);
+    abort();
+}
@@ -0,0 +1,86 @@
+/* File: mock_spi.c
+ * -------------
+ * spi.h for the host build. Instead of a register block, each transfer is played out as
+ * an SCLK/MOSI waveform on the SPI1 pins at the configured bit rate, starting when the bus
+ * is next free. The blocking calls wait for their waveform to end, the DMA and interrupt
+ * ones return at once and stay busy until it would have.
+ */
+
+#include "mock.h"
+#include "spi.h"
+#include <stddef.h>
+
+#define SPI1_SCLK GPIO_PD11
+#define SPI1_MOSI GPIO_PD12
+
+static struct {
+    long rate;
+    int cpol;
+    uint64_t busy_until_ns;
+    spi_callback_t callback;
+    void *aux_data;
+} spi;
+
+void spi_init(spi_mode_t mode, long rate) {
+    spi.rate = rate;
+    spi.cpol = (mode == SPI_MODE_2 || mode == SPI_MODE_3);
+    mock_gpio_log(SPI1_SCLK, spi.cpol, mock_now_ns());
+}
+
+long spi_get_rate(void) {
+    return spi.rate;
+}
+
+// Logs the waveform of tx MSB first, data changing on the leading edge of each bit and
+// sampled mid-bit, returns when the last bit ends
+static uint64_t play(const uint8_t *tx, int len) {
+    uint64_t half_ns = 500000000ULL / spi.rate;
+    uint64_t t = mock_now_ns() > spi.busy_until_ns ? mock_now_ns() : spi.busy_until_ns;
+
+    for (int i = 0; i < len; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            mock_gpio_log(SPI1_MOSI, (tx[i] >> bit) & 1, t);
+            mock_gpio_log(SPI1_SCLK, !spi.cpol, t + half_ns);
+            mock_gpio_log(SPI1_SCLK, spi.cpol, t + 2 * half_ns);
+            t += 2 * half_ns;
+        }
+    }
+    spi.busy_until_ns = t;
+    return t;
+}
+
+static void wait_until(uint64_t t) {
+    if (t > mock_now_ns()) mock_advance_ns(t - mock_now_ns());
+}
+
+void spi_transfer(uint8_t *tx, uint8_t *rx, int len) {
+    wait_until(play(tx, len));
+    for (int i = 0; i < len; i++) {
+        rx[i] = 0xff; // nothing on MISO
+    }
+}
+
+void spi_write(const uint8_t *tx, int len) {
+    wait_until(play(tx, len));
+}
+
+void spi_write_dma(const uint8_t *tx, int len) {
+    wait_until(spi.busy_until_ns);
+    play(tx, len);
+}
+
+static void transfer_done(void *aux_data) {
+    if (spi.callback) spi.callback(spi.aux_data);
+}
+
+void spi_transfer_start(const uint8_t *tx, int len, spi_callback_t callback, void *aux_data) {
+    wait_until(spi.busy_until_ns);
+    spi.callback = callback;
+    spi.aux_data = aux_data;
+    mock_schedule(play(tx, len), transfer_done, NULL);
+}
+
+bool spi_busy(void) {
+    mock_advance_ns(MOCK_POLL_NS);
+    return mock_now_ns() < spi.busy_until_ns;
+}
@@ -0,0 +1,178 @@
+/* File: replay.c
+ * -------------
+ * Replays IR traces recorded in game mode 3 (see ir_trace.h) through the game's scoring
+ * code (scoring.c) and reports every transit with its classification and detection latency,
+ * plus a summary. The input is the uart log, everything outside the IRTRACE markers is
+ * skipped.
+ *
+ *     ./host/replay [-g gap_ms] [-p poll_ms] game.log
+ *
+ * -p is how often the main loop polls the hoops (default 1 ms), latency runs from the
+ * first beam breaking to the transit being reported there. -g shortens every stretch with
+ * no beam broken and no transit pending to at most gap_ms, turning a recorded game into a
+ * rapid-fire burst while keeping each transit's timing.
+ */
+
+#include "scoring.h"
+#include "ir_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SHOTS 4096
+#define MAX_HOOPS (IR_TRACE_CHANNELS / 2) // channel = hoop * 2 + sensor
+#define REPEATS 1000 // replays of the whole trace when timing the scoring code
+
+typedef struct {
+    scoring_shot_t shot;
+    systime_t scored_ticks;
+    int hoop;
+} shot_t;
+
+static uint8_t trace[IR_TRACE_BYTES];
+static int trace_len;
+static shot_t shots[MAX_SHOTS];
+static int nshots;
+
+// Reads the hex between the IRTRACE markers of a uart log
+static bool load(FILE *fp) {
+    char line[256];
+    int declared = -1, dropped = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (declared < 0) {
+            if (sscanf(line, "IRTRACE 2 %d %d", &declared, &dropped) == 2) continue;
+            declared = -1;
+            continue;
+        }
+        if (strncmp(line, "IRTRACE END", 11) == 0) break;
+        for (char *p = line; p[0] && p[1] && trace_len < IR_TRACE_BYTES; p += 2) {
+            unsigned int byte;
+            if (sscanf(p, "%2x", &byte) != 1) break;
+            trace[trace_len++] = byte;
+        }
+    }
+    if (declared < 0 || trace_len != declared || trace_len < IR_TRACE_HEADER_BYTES || memcmp(trace, "IRT2", 4) != 0) {
+        return false;
+    }
+    if (dropped) printf("warning: %d edges were dropped when the trace filled up\n", dropped);
+    return true;
+}
+
+static systime_t header_ticks(void) {
+    uint64_t start = 0;
+    for (int i = 0; i < 8; i++) start |= (uint64_t)trace[4 + i] << (8 * i);
+    return start;
+}
+
+static void add_shot(int hoop, const scoring_shot_t *shot, systime_t done, systime_t poll_ticks) {
+    if (nshots == MAX_SHOTS) return;
+    shot_t *s = &shots[nshots++];
+    s->shot = *shot;
+    s->hoop = hoop;
+    s->scored_ticks = (done / poll_ticks + 1) * poll_ticks; // next main loop pass
+}
+
+// Runs the trace through scoring, fills shots[] when record is set. Returns the edge count.
+static int replay(systime_t gap_ticks, systime_t poll_ticks, bool record) {
+    scoring_fusion_t fusions[MAX_HOOPS];
+    int pos = IR_TRACE_HEADER_BYTES, nedges = 0, nbroken = 0;
+    systime_t prev = header_ticks(), last_raw = prev, t = prev;
+    const systime_t max_ticks = systime_ms_to_ticks(SCORING_MAX_TRANSIT_MS);
+    scoring_shot_t shot;
+    ir_event_t ev;
+
+    for (int i = 0; i < MAX_HOOPS; i++) scoring_fusion_reset(&fusions[i]);
+    if (record) nshots = 0;
+    while (ir_trace_decode(trace, trace_len, &pos, &prev, &ev)) {
+        systime_t delta = ev.ticks - last_raw;
+        last_raw = ev.ticks;
+        bool pending = false;
+        for (int i = 0; i < MAX_HOOPS; i++) pending |= fusions[i].state != SCORING_IDLE;
+        t += (gap_ticks && nbroken == 0 && !pending && delta > gap_ticks) ? gap_ticks : delta;
+        nedges++;
+
+        for (int i = 0; i < MAX_HOOPS; i++) { // transits that timed out before this edge
+            scoring_fusion_t *f = &fusions[i];
+            systime_t since = f->since_ticks;
+            if (scoring_fuse_timeout(f, t, &shot) && record) add_shot(i, &shot, since + max_ticks, poll_ticks);
+        }
+        scoring_fusion_t *f = &fusions[ev.channel / 2];
+        bool was_broken = f->broken[ev.channel & 1];
+        if (ev.level != was_broken) nbroken += ev.level ? 1 : -1;
+        if (scoring_fuse_edge(f, ev.channel & 1, ev.level, t, &shot) && record) {
+            add_shot(ev.channel / 2, &shot, t, poll_ticks);
+        }
+    }
+    for (int i = 0; i < MAX_HOOPS; i++) { // let the last transits time out
+        systime_t since = fusions[i].since_ticks;
+        if (scoring_fuse_timeout(&fusions[i], since + max_ticks + 1, &shot) && record) {
+            add_shot(i, &shot, since + max_ticks, poll_ticks);
+        }
+    }
+    return nedges;
+}
+
+int main(int argc, char *argv[]) {
+    double gap_ms = 0, poll_ms = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "g:p:")) != -1) {
+        if (opt == 'g') gap_ms = atof(optarg);
+        else if (opt == 'p') poll_ms = atof(optarg);
+        else {
+            fprintf(stderr, "usage: %s [-g gap_ms] [-p poll_ms] game.log\n", argv[0]);
+            return 1;
+        }
+    }
+    FILE *fp = (optind < argc) ? fopen(argv[optind], "r") : stdin;
+    if (!fp || !load(fp)) {
+        fprintf(stderr, "no IR trace found\n");
+        return 1;
+    }
+
+    systime_t gap_ticks = gap_ms * SYSTIME_TICKS_PER_MS;
+    systime_t poll_ticks = poll_ms * SYSTIME_TICKS_PER_MS;
+    if (poll_ticks == 0) poll_ticks = 1;
+    int nedges = replay(gap_ticks, poll_ticks, true);
+
+    const double tpms = SYSTIME_TICKS_PER_MS;
+    systime_t t0 = header_ticks();
+    int counts[SCORING_NO_ENTRY + 1] = {0}, points[3] = {0}, window_max = 0;
+    double latency_sum = 0, latency_max = 0;
+    for (int i = 0; i < nshots; i++) {
+        const shot_t *s = &shots[i];
+        double latency = (s->scored_ticks - s->shot.start_ticks) / tpms;
+        printf("%9.3f s  hoop %d  transit %7.1f ms  %-10s %d  latency %7.1f ms\n",
+               (s->shot.start_ticks - t0) / (tpms * 1000), s->hoop + 1, s->shot.transit_ticks / tpms,
+               scoring_result_name(s->shot.result), s->shot.points, latency);
+        counts[s->shot.result]++;
+        points[s->shot.points]++;
+        if (s->shot.points) {
+            latency_sum += latency;
+            if (latency > latency_max) latency_max = latency;
+        }
+        int in_window = 0; // scoring shots in the second that ends with this one
+        for (int j = i; j >= 0 && s->scored_ticks - shots[j].scored_ticks < SYSTIME_TICKS_PER_SEC; j--) {
+            in_window += shots[j].shot.points != 0;
+        }
+        if (in_window > window_max) window_max = in_window;
+    }
+
+    struct timespec a, b;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &a);
+    for (int i = 0; i < REPEATS; i++) replay(gap_ticks, poll_ticks, false);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &b);
+    double secs = (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+
+    int scored = counts[SCORING_SCORED];
+    printf("\n%d edges, %d transits: %d scored (%d 1 point, %d 2 point)", nedges, nshots, scored, points[1], points[2]);
+    for (int r = SCORING_JITTER; r <= SCORING_NO_ENTRY; r++) printf(", %d %s", counts[r], scoring_result_name(r));
+    printf("\n");
+    if (scored) {
+        printf("latency from first break to score: mean %.1f ms, max %.1f ms\n", latency_sum / scored, latency_max);
+    }
+    printf("most scoring shots in one second: %d\n", window_max);
+    if (secs > 0) printf("scoring code replays %.0f edges/s on this host\n", (double)nedges * REPEATS / secs);
+    return 0;
+}
@@ -0,0 +1,117 @@
+/* File: tone_test.c
+ * -------------
+ * Checks the compile-time tone tables of sound.h against the formulas the original
+ * play_note and play_rest used at runtime: every half-period against
+ * (1000000 * 100) / (2 * frequency_100x) microseconds, every length against
+ * 1000000 / ((bpm * 4) / 60) microseconds per sixteenth. Covers all notes in octaves 0-7
+ * and every step of the game's melodies (melodies.h).
+ *
+ *     make test
+ */
+
+#include "sound.h"
+#include "melodies.h"
+#include <stdio.h>
+
+typedef struct {
+    int base_freq_100x; // 0 for a rest
+    int note_time, octave;
+} step_t;
+
+#define NOTE(note, note_time, octave) {note, note_time, octave}
+#define REST(rest_time) {0, rest_time, 0}
+
+static const step_t one_point_steps[] = {ONE_POINT_STEPS};
+static const step_t two_point_steps[] = {TWO_POINT_STEPS};
+static const step_t win_steps[] = {WIN_STEPS};
+static const step_t final_ten_steps[] = {FINAL_TEN_STEPS};
+static const step_t game_start_steps[] = {GAME_START_STEPS};
+#undef NOTE
+#undef REST
+
+#define NOTE(note, note_time, octave) TONE(note, note_time, octave, MELODY_BPM)
+#define REST(rest_time) REST_TONE(rest_time, MELODY_BPM)
+static const tone_t one_point_tones[] = {ONE_POINT_STEPS};
+static const tone_t two_point_tones[] = {TWO_POINT_STEPS};
+static const tone_t win_tones[] = {WIN_STEPS};
+static const tone_t final_ten_tones[] = {FINAL_TEN_STEPS};
+static const tone_t game_start_tones[] = {GAME_START_STEPS};
+
+#define MELODY(name) {#name, name##_steps, name##_tones, sizeof(name##_steps) / sizeof(name##_steps[0])}
+static const struct {
+    const char *name;
+    const step_t *steps;
+    const tone_t *tones;
+    int len;
+} melodies[] = {
+    MELODY(one_point), MELODY(two_point), MELODY(win), MELODY(final_ten), MELODY(game_start),
+};
+
+static const struct {
+    const char *name;
+    int freq_100x;
+} notes[] = {
+    {"C", C}, {"C#", C_sharp}, {"D", D}, {"D#", D_sharp}, {"E", E}, {"F", F},
+    {"F#", F_sharp}, {"G", G}, {"G#", G_sharp}, {"A", A}, {"A#", A_sharp}, {"B", B},
+};
+
+static int failures;
+
+static void fail(const char *what, const char *name, const step_t *step, long want, long got) {
+    printf("FAIL %s: %s freq %d time %d octave %d, want %ld got %ld\n", what, name, step->base_freq_100x,
+           step->note_time, step->octave, want, got);
+    failures++;
+}
+
+// Compares one tone against the runtime formulas of the original play_note/play_rest
+static void check(const char *name, const step_t *step, int bpm, const tone_t *tone) {
+    long sixteenth_us = 1000000 / ((bpm * 4) / 60);
+    long duration_ticks = sixteenth_us * step->note_time * 24;
+    if (tone->duration_ticks != duration_ticks) fail("length", name, step, duration_ticks, tone->duration_ticks);
+
+    if (step->base_freq_100x == 0) {
+        if (tone->half_period_ticks != 0 || tone->half_cycles != 0) fail("rest", name, step, 0, tone->half_period_ticks);
+        return;
+    }
+    long frequency_100x = (long)step->base_freq_100x << step->octave;
+    long old_half_us = (1000000 * 100) / (2 * frequency_100x);
+    long half = tone->half_period_ticks;
+    if (half / 24 != old_half_us) fail("half-period us", name, step, old_half_us, half / 24);
+
+    // the tick period is the exact one rounded down, (1000000 * 100 * 24) / (2 * frequency_100x)
+    long exact_x2f = 1000000L * 100 * 24;
+    if (half * 2 * frequency_100x > exact_x2f || (half + 1) * 2 * frequency_100x <= exact_x2f) {
+        fail("half-period ticks", name, step, exact_x2f / (2 * frequency_100x), half);
+    }
+
+    // whole cycles, ending low, that fill the note without running over it
+    long cycles = tone->half_cycles;
+    if (cycles % 2 || cycles * half > duration_ticks || (cycles + 2) * half <= duration_ticks) {
+        fail("half cycles", name, step, duration_ticks / half & ~1L, cycles);
+    }
+}
+
+int main(void) {
+    int checked = 0;
+    const int bpms[] = {60, 120, MELODY_BPM};
+    for (int n = 0; n < (int)(sizeof(notes) / sizeof(notes[0])); n++) {
+        for (int octave = 0; octave <= 7; octave++) {
+            for (int b = 0; b < 3; b++) {
+                for (int note_time = sixteenth; note_time <= whole; note_time *= 2) {
+                    step_t step = {notes[n].freq_100x, note_time, octave};
+                    tone_t tone = TONE(notes[n].freq_100x, note_time, octave, bpms[b]);
+                    check(notes[n].name, &step, bpms[b], &tone);
+                    checked++;
+                }
+            }
+        }
+    }
+    for (int m = 0; m < (int)(sizeof(melodies) / sizeof(melodies[0])); m++) {
+        for (int i = 0; i < melodies[m].len; i++) {
+            check(melodies[m].name, &melodies[m].steps[i], MELODY_BPM, &melodies[m].tones[i]);
+            checked++;
+        }
+    }
+    printf("%d tones checked, %d failures\n", checked, failures);
+    return failures != 0;
+}
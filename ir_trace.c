@@ -0,0 +1,69 @@
+/* File: ir_trace.c
+ * -------------
+ * IR edge trace recording, see ir_trace.h.
+ */
+
+#include "ir_trace.h"
+#include "uart_tx.h"
+#include "systime.h"
+
+static struct {
+    uint8_t buf[IR_TRACE_BYTES];
+    int len;
+    systime_t prev_ticks;
+    int dropped;
+    volatile bool recording;
+} trace;
+
+void ir_trace_start(void) {
+    trace.recording = false;
+    trace.len = 0;
+    trace.dropped = 0;
+    trace.prev_ticks = systime_now();
+
+    const char magic[4] = {'I', 'R', 'T', '2'};
+    for (int i = 0; i < 4; i++) {
+        trace.buf[trace.len++] = magic[i];
+    }
+    uint64_t start = trace.prev_ticks;
+    for (int i = 0; i < 8; i++) {
+        trace.buf[trace.len++] = start >> (8 * i);
+    }
+    trace.recording = true;
+}
+
+void ir_trace_stop(void) {
+    trace.recording = false;
+}
+
+void ir_trace_record(int channel, int level, systime_t ticks) {
+    if (!trace.recording) return;
+
+    uint8_t bytes[10];
+    int n = 0;
+    uint64_t val = ((uint64_t)(ticks - trace.prev_ticks) << 5) | ((channel & 0xf) << 1) | (level & 1);
+    do {
+        bytes[n] = val & 0x7f;
+        val >>= 7;
+        if (val) bytes[n] |= 0x80;
+        n++;
+    } while (val);
+
+    if (trace.dropped || trace.len + n > IR_TRACE_BYTES) {
+        trace.dropped++; // once one edge is lost the rest go too, so the trace never has gaps
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        trace.buf[trace.len++] = bytes[i];
+    }
+    trace.prev_ticks = ticks;
+}
+
+void ir_trace_dump(void) {
+    uart_tx_printf("\nIRTRACE 2 %d %d\n", trace.len, trace.dropped);
+    for (int i = 0; i < trace.len; i++) {
+        uart_tx_printf("%02x", trace.buf[i]);
+        if (i % 32 == 31 || i == trace.len - 1) uart_tx_printf("\n");
+    }
+    uart_tx_printf("IRTRACE END\n");
+}
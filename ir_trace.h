@@ -0,0 +1,64 @@
+/* File: ir_trace.h
+ * -------------
+ * Records the raw IR sensor edges of a game into a compact binary trace for replay on the
+ * host (host/replay.c). A channel is one sensor, hoop * 2 + 0 for the top sensor or + 1
+ * for the bottom one. Each edge is one unsigned LEB128 varint of
+ * (ticks since the previous edge << 5) | (channel << 1) | level, so a typical edge takes
+ * 2-3 bytes. The trace starts with the 4-byte magic "IRT2" and the 8-byte little-endian
+ * tick that the first delta counts from.
+ *
+ * ir_trace_dump prints the trace over the uart as hex between marker lines:
+ *     IRTRACE 2 <bytes> <dropped edges>
+ *     <up to 32 bytes of hex per line>
+ *     IRTRACE END
+ */
+#ifndef _IR_TRACE_H
+#define _IR_TRACE_H
+
+#include "systime.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IR_TRACE_BYTES 16384
+#define IR_TRACE_CHANNELS 16
+#define IR_TRACE_HEADER_BYTES 12
+
+typedef struct {
+    systime_t ticks;
+    int channel;
+    int level;
+} ir_event_t;
+
+// clears the trace and records edges from now on
+void ir_trace_start(void);
+
+void ir_trace_stop(void);
+
+// Appends one edge, called from the IR interrupt handlers. Edges that don't fit are counted
+// as dropped.
+void ir_trace_record(int channel, int level, systime_t ticks);
+
+void ir_trace_dump(void);
+
+// Decodes the edge at *pos of an encoded trace, advancing *pos. prev_ticks carries the
+// running tick count, start it at the header's tick. Returns false at the end or on a
+// truncated edge.
+static inline bool ir_trace_decode(const uint8_t *buf, int len, int *pos, systime_t *prev_ticks, ir_event_t *ev) {
+    uint64_t val = 0;
+    int shift = 0;
+    while (*pos < len) {
+        uint8_t byte = buf[(*pos)++];
+        val |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+            *prev_ticks += val >> 5;
+            ev->ticks = *prev_ticks;
+            ev->channel = (val >> 1) & 0xf;
+            ev->level = val & 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,130 @@
+/* File: irq_stats.c
+ * -------------
+ * Interrupt handler timing histograms, see irq_stats.h.
+ */
+
+#include "irq_stats.h"
+#include "hal.h"
+#include "uart_tx.h"
+#include "hstimer.h"
+#include <stddef.h>
+
+static struct {
+    irq_stats_t handlers[IRQ_STATS_MAX];
+    int count;
+    unsigned long cycles_per_ms;       // measured on the first registration
+    unsigned long cycles_per_clock_16; // CPU cycles per high-speed timer clock, 16 fraction bits
+} stats;
+
+// number of bits in val, without a divide or a library call
+static int bucket(unsigned long val) {
+    int bits = 0;
+    if (val >> 32) { val >>= 32; bits += 32; }
+    if (val >> 16) { val >>= 16; bits += 16; }
+    if (val >> 8) { val >>= 8; bits += 8; }
+    if (val >> 4) { val >>= 4; bits += 4; }
+    if (val >> 2) { val >>= 2; bits += 2; }
+    if (val >> 1) { val >>= 1; bits += 1; }
+    bits += val;
+    return bits < IRQ_STATS_BUCKETS ? bits : IRQ_STATS_BUCKETS - 1;
+}
+
+static void record(irq_histogram_t *h, unsigned long val) {
+    h->counts[bucket(val)]++;
+    h->total++;
+    if (val > h->max) h->max = val;
+}
+
+// Runs in place of every instrumented handler, stats is its aux_data
+static void timed_handler(void *aux_data) {
+    unsigned long entry = hal_cycles();
+    irq_stats_t *s = (irq_stats_t *)aux_data;
+
+    if (s->hstimer >= 0) { // read before the handler, which may restart its timer
+        uint64_t late = hal_hstimer_elapsed(s->hstimer);
+        record(&s->latency, (late * stats.cycles_per_clock_16) >> 16);
+    }
+    s->fn(s->aux_data);
+    record(&s->duration, hal_cycles() - entry);
+}
+
+static irq_stats_t *new_stats(int id, handlerfn_t fn, void *aux_data, const char *name) {
+    if (stats.cycles_per_ms == 0) {
+        stats.cycles_per_ms = hal_measure_cycles_per_ms();
+        stats.cycles_per_clock_16 = (stats.cycles_per_ms << 16) / (HAL_HSTIMER_HZ / 1000);
+    }
+    if (stats.count == IRQ_STATS_MAX) return NULL;
+
+    irq_stats_t *s = &stats.handlers[stats.count++];
+    *s = (irq_stats_t){.name = name, .id = id, .fn = fn, .aux_data = aux_data, .hstimer = -1};
+    return s;
+}
+
+irq_stats_t *irq_stats_register_handler(interrupt_source_t source, handlerfn_t fn, void *aux_data, const char *name) {
+    irq_stats_t *s = new_stats(source, fn, aux_data, name);
+    if (s && source == INTERRUPT_SOURCE_HSTIMER0) s->hstimer = HSTIMER0;
+    if (s && source == INTERRUPT_SOURCE_HSTIMER1) s->hstimer = HSTIMER1;
+    if (s) {
+        interrupts_register_handler(source, timed_handler, s);
+    } else {
+        interrupts_register_handler(source, fn, aux_data);
+    }
+    return s;
+}
+
+irq_stats_t *irq_stats_gpio_register_handler(gpio_id_t pin, handlerfn_t fn, void *aux_data, const char *name) {
+    irq_stats_t *s = new_stats(pin, fn, aux_data, name);
+    if (s) {
+        gpio_interrupt_register_handler(pin, timed_handler, s);
+    } else {
+        gpio_interrupt_register_handler(pin, fn, aux_data);
+    }
+    return s;
+}
+
+void irq_stats_reset(void) {
+    for (int i = 0; i < stats.count; i++) {
+        irq_stats_t *s = &stats.handlers[i];
+        s->duration = s->latency = (irq_histogram_t){0};
+    }
+}
+
+// cycles as microseconds with one decimal
+static void print_us(const char *label, unsigned long cycles) {
+    unsigned long tenths = cycles * 10000 / stats.cycles_per_ms;
+    uart_tx_printf(" %s %ld.%ld", label, tenths / 10, tenths % 10);
+}
+
+// Upper bound of the bucket the pct-th percentile falls in
+static unsigned long percentile(const irq_histogram_t *h, int pct) {
+    uint32_t want = ((uint64_t)h->total * pct + 99) / 100, seen = 0;
+    for (int b = 0; b < IRQ_STATS_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= want) return (b == IRQ_STATS_BUCKETS - 1) ? h->max : (1UL << b) - 1;
+    }
+    return h->max;
+}
+
+static void print_histogram(const char *label, const irq_histogram_t *h) {
+    uart_tx_printf("  %s:", label);
+    print_us("max", h->max);
+    print_us("p50 <", percentile(h, 50));
+    print_us("p90 <", percentile(h, 90));
+    print_us("p99 <", percentile(h, 99));
+    uart_tx_printf(" us\n    ");
+    for (int b = 0; b < IRQ_STATS_BUCKETS; b++) { // bucket b holds values below 2^b cycles
+        if (h->counts[b]) uart_tx_printf(" <2^%d:%d", b, h->counts[b]);
+    }
+    uart_tx_printf("\n");
+}
+
+void irq_stats_dump(void) {
+    uart_tx_printf("\nIRQSTATS %d handlers, %ld cycles/ms\n", stats.count, stats.cycles_per_ms);
+    for (int i = 0; i < stats.count; i++) {
+        const irq_stats_t *s = &stats.handlers[i];
+        uart_tx_printf("%s (%d): %d runs\n", s->name, s->id, s->duration.total);
+        if (s->duration.total) print_histogram("duration", &s->duration);
+        if (s->latency.total) print_histogram("latency", &s->latency);
+    }
+    uart_tx_printf("IRQSTATS END\n");
+}
@@ -0,0 +1,48 @@
+/* File: irq_stats.h
+ * -------------
+ * Interrupt handler instrumentation. Drivers register their handlers through the functions
+ * here instead of interrupts_register_handler and gpio_interrupt_register_handler, which
+ * puts a wrapper in front that times every run of the handler with the CPU cycle counter.
+ * Each handler gets log2 histograms of:
+ *   duration   cycles from entering the handler to returning
+ *   latency    cycles from when the interrupt was raised to entering the handler. Only for
+ *              the high-speed timers, whose count says how long ago they reloaded, nothing
+ *              says when a GPIO edge or a SPI FIFO interrupt was raised.
+ * irq_stats_dump prints the count, max and percentiles of every handler over the uart.
+ */
+#ifndef _IRQ_STATS_H
+#define _IRQ_STATS_H
+
+#include "interrupts.h"
+#include "gpio_interrupt.h"
+#include <stdint.h>
+
+#define IRQ_STATS_MAX 16     // instrumented handlers, two per hoop plus the timers, SPI and uart
+#define IRQ_STATS_BUCKETS 32 // bucket b counts values of b bits, the last one everything longer
+
+typedef struct {
+    uint32_t counts[IRQ_STATS_BUCKETS];
+    uint32_t total;
+    unsigned long max;
+} irq_histogram_t;
+
+typedef struct {
+    const char *name;
+    int id; // interrupt source or GPIO pin
+    handlerfn_t fn;
+    void *aux_data;
+    irq_histogram_t duration, latency;
+    int hstimer; // high-speed timer behind the source, -1 if none
+} irq_stats_t;
+
+// Registers fn for source behind the timing wrapper. Returns the handler's stats, which
+// fall back to a plain registration (and NULL) once IRQ_STATS_MAX handlers are in use.
+irq_stats_t *irq_stats_register_handler(interrupt_source_t source, handlerfn_t fn, void *aux_data, const char *name);
+
+irq_stats_t *irq_stats_gpio_register_handler(gpio_id_t pin, handlerfn_t fn, void *aux_data, const char *name);
+
+void irq_stats_reset(void);
+
+void irq_stats_dump(void);
+
+#endif
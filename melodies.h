@@ -0,0 +1,30 @@
+/* File: melodies.h
+ * -------------
+ * The game's melodies as lists of NOTE(note, length in sixteenths, octave) and
+ * REST(length in sixteenths) steps at MELODY_BPM. The includer defines NOTE and REST:
+ * myprogram.c expands them into tone tables (sound.h), host/tone_test into the raw steps
+ * it checks the tables against.
+ */
+#ifndef _MELODIES_H
+#define _MELODIES_H
+
+#define MELODY_BPM 300
+
+#define ONE_POINT_STEPS \
+    NOTE(B, 1, 5), NOTE(E, 4, 6)
+
+#define TWO_POINT_STEPS \
+    NOTE(B, 1, 5), NOTE(E, 1, 6), NOTE(A, 4, 6)
+
+#define WIN_STEPS \
+    NOTE(D, 2, 4), NOTE(D, 2, 4), NOTE(D, 2, 4), NOTE(G, 6, 4), REST(1), \
+    NOTE(B, 2, 4), NOTE(B, 2, 4), NOTE(B, 2, 4), NOTE(D, 6, 5), REST(1), \
+    NOTE(G, 2, 5), NOTE(G, 2, 5), NOTE(G, 2, 5), NOTE(B, 12, 5)
+
+#define FINAL_TEN_STEPS \
+    NOTE(A, 2, 5), REST(1), NOTE(A, 2, 5)
+
+#define GAME_START_STEPS \
+    NOTE(E, 16, 4), REST(8), NOTE(E, 16, 4), REST(8), NOTE(E, 16, 4), REST(8), NOTE(E, 8, 5)
+
+#endif
@@ -3,7 +3,12 @@
  * Authors: Alexander Jeon and John Carlson
  * Main program for the basketball game. Allows normal basketball arcade mode and a mode where
  * the hoops switch which team they score for every 5 seconds. The mode is changed by clicking the button,
- * then selected by holding the button.
+ * then selected by holding the button. Mode 3 plays a normal game while recording every IR sensor edge,
+ * and prints the trace over the uart at the end for host/replay, followed by the interrupt handler timings
+ * and the event trace (host/evdecode). Each hoop has a sensor at the rim and
+ * one under the net, a shot only counts when the ball breaks the rim beam and then the net beam.
+ * The hoops and teams come from the hoop_configs and teams tables below, add a row for another hoop.
+ * After setup main hands over to the event loop in scheduler.c, and the game runs as tasks on timers.
  */
 
 #include "uart.h"
@@ -12,29 +17,30 @@
 #include "gpio_extra.h"
 #include "printf.h"
 #include "timer.h"
+#include "systime.h"
 #include "interrupts.h"
 #include "gpio_interrupt.h"
 #include "Display.h"
 #include "sound.h"
-#include "ringbuffer.h"
+#include "melodies.h"
+#include "teams.h"
 #include "dotstar.h"
 #include "hstimer.h"
 #include "button.h"
+#include "animation.h"
+#include "hoop_sensor.h"
+#include "ir_trace.h"
+#include "scheduler.h"
+#include "irq_stats.h"
+#include "evtrace.h"
+#include "dlog.h"
+#include "uart_tx.h"
 
-gpio_id_t sensor_1 = GPIO_PB0;
-gpio_id_t sensor_2 = GPIO_PB1;
-gpio_id_t buzzer_1 = GPIO_PD21;
-gpio_id_t buzzer_2 = GPIO_PD22; //not used in current code, all sounds use buzzer_1
-
-gpio_id_t clock_team_1 = GPIO_PG13;
-gpio_id_t DIO_team_1 = GPIO_PG12;
-
-gpio_id_t clock_team_2 = GPIO_PB6;
-gpio_id_t DIO_team_2 = GPIO_PD17;
+gpio_id_t buzzer_1 = GPIO_PD21; //game-wide sounds (start, final ten, win) play on the first hoop's buzzer
 
 gpio_id_t clock_countdown = GPIO_PB12;
 gpio_id_t DIO_countdown = GPIO_PB11;
-DisplayConfig team1_scoreboard, team2_scoreboard, countdown_timer;
+DisplayConfig countdown_timer;
 
 //led strip 1 pins are the default hardware SPI pins as of now (PD11 and PD12)
 gpio_id_t strip2_mosi = GPIO_PC1;
@@ -42,246 +48,332 @@ gpio_id_t strip2_sclk = GPIO_PD15;
 led_strip strip2;
 
 gpio_id_t button = GPIO_PB4; //button for selecting mode
-static int nleds = 10; //number of LEDS on DO NOT GO OVER 10!!!!!!
+static int nleds = DOTSTAR_MAX_LEDS; //number of LEDs on each strip, the full hoop
+
+#define LED_FPS 30
+#define LED_SPI_HZ 12000000 //strip 1 bit rate, 6x the original 2 MHz
+#define NO_STRIP -1
+
+struct team {
+    const char *name;
+    led_t color; //of the LED strips of the hoops scoring for the team
+};
+
+#define TEAM(id, name, red, green, blue) [id] = {name, COLOR(red, green, blue)},
+static const struct team teams[NUM_TEAMS] = {TEAM_LIST};
+#undef TEAM
 
-#define RED 0 
-#define BLUE 1
-int hoop_1_team = RED; 
-int hoop_2_team = BLUE;
-//the above are starting states
+//the team a hoop scores for after each swap in mode 2, maps every team to a different one
+static const int team_rotation[NUM_TEAMS] = {[RED] = BLUE, [BLUE] = RED};
+
+struct hoop_config {
+    gpio_id_t rim_sensor, net_sensor; //the net sensor is under the rim sensor of the same hoop
+    gpio_id_t buzzer; //score sounds of this hoop
+    gpio_id_t display_clock, display_dio; //score display
+    int strip; //LED strip that animates for this hoop, or NO_STRIP
+    int team; //starting team
+}; //all devices attached to one hoop
+
+static const struct hoop_config hoop_configs[] = {
+    {GPIO_PB0, GPIO_PB2, GPIO_PD21, GPIO_PG13, GPIO_PG12, 0, RED},
+    {GPIO_PB1, GPIO_PB3, GPIO_PD22, GPIO_PB6, GPIO_PD17, 1, BLUE},
+};
+#define NUM_HOOPS (int)(sizeof(hoop_configs) / sizeof(hoop_configs[0]))
+
+_Static_assert(NUM_HOOPS * 2 <= IR_TRACE_CHANNELS, "every hoop needs two ir_trace channels");
+_Static_assert(NUM_HOOPS <= 8 && NUM_TEAMS <= 16, "team swap events pack 4 bits per hoop");
 
 struct hoop {
+    const struct hoop_config *config;
     int team;
-    gpio_id_t IR_sensor;
-    gpio_id_t buzzer;
-    rb_t *ring_buf; //not used in current version
-    DisplayConfig *scoreboard;
-}; //hoop struct contains all devices attached to that hoop
-
-struct hoops_in_game {
-    struct hoop *hoop1;
-    struct hoop *hoop2;
-}; //pointers to the hoops used in the game
-
-//Plays the 1 point sound through the buzzer on the breadboard
+    int index; //hoop number from 0, the row of hoop_configs
+    DisplayConfig scoreboard;
+    hoop_sensor_t sensor; //rim and net sensors, queue their edges from the interrupt handlers
+};
+
+//melodies are in melodies.h as {note, length in sixteenths, octave} steps, turned into
+//tone tables by the compiler
+#define NOTE(note, note_time, octave) TONE(note, note_time, octave, MELODY_BPM)
+#define REST(rest_time) REST_TONE(rest_time, MELODY_BPM)
+static const tone_t one_point_tones[] = {ONE_POINT_STEPS};
+static const tone_t two_point_tones[] = {TWO_POINT_STEPS};
+static const tone_t win_tones[] = {WIN_STEPS};
+static const tone_t final_ten_tones[] = {FINAL_TEN_STEPS};
+static const tone_t game_start_tones[] = {GAME_START_STEPS};
+#define MELODY(tones) {tones, sizeof(tones) / sizeof(tones[0])}
+static const melody_t one_point_melody = MELODY(one_point_tones);
+static const melody_t two_point_melody = MELODY(two_point_tones);
+static const melody_t win_melody = MELODY(win_tones);
+static const melody_t final_ten_melody = MELODY(final_ten_tones);
+static const melody_t game_start_melody = MELODY(game_start_tones);
+
+//Plays the 1 point sound through the buzzer on the breadboard, cutting off any earlier score sound
 void play_1point_sound(gpio_id_t buzzer) {
-    play_note(B, 1, 5, 300, buzzer);
-    play_note(E, 4, 6, 300, buzzer);
+    sound_play(&one_point_melody, buzzer, true);
 }
 
-//Plays the 2 point sound through the buzzer on the breadboard
+//Plays the 2 point sound through the buzzer on the breadboard, cutting off any earlier score sound
 void play_2point_sound(gpio_id_t buzzer) {
-    play_note(B, 1, 5, 300, buzzer);
-    play_note(E, 1, 6, 300, buzzer);
-    play_note(A, 4, 6, 300, buzzer);
+    sound_play(&two_point_melody, buzzer, true);
 }
 
 //Sound played when a team wins
 void play_win_sound(gpio_id_t buzzer) {
-    play_note(D, 2, 4, 300, buzzer);
-    play_note(D, 2, 4, 300, buzzer);
-    play_note(D, 2, 4, 300, buzzer);
-    play_note(G, 6, 4, 300, buzzer);
-    play_rest(1, 300, buzzer);
-    play_note(B, 2, 4, 300, buzzer);
-    play_note(B, 2, 4, 300, buzzer);
-    play_note(B, 2, 4, 300, buzzer);
-    play_note(D, 6, 5, 300, buzzer);
-    play_rest(1, 300, buzzer);
-    play_note(G, 2, 5, 300, buzzer);
-    play_note(G, 2, 5, 300, buzzer);
-    play_note(G, 2, 5, 300, buzzer);
-    play_note(B, 12, 5, 300, buzzer);
+    sound_play(&win_melody, buzzer, true);
+}
+
+//Called by the game clock when 10 seconds remain, waits behind any score sound and
+//runs a white bar down both LED strips until time is up
+static void warn_final_ten(void *aux_data) {
+    sound_play(&final_ten_melody, buzzer_1, false);
+    for (int strip = 0; strip < ANIMATION_STRIPS; strip++) {
+        animation_countdown_bar(strip, COLOR(0x40, 0x40, 0x40), 10 * 1000);
+    }
 }
 
 void play_game_start(gpio_id_t buzzer) {
-    play_note(E, 16, 4, 300, buzzer);
-    play_rest(8, 300, buzzer);
-    play_note(E, 16, 4, 300, buzzer);
-    play_rest(8, 300, buzzer);
-    play_note(E, 16, 4, 300, buzzer);
-    play_rest(8, 300, buzzer);
-    play_note(E, 8, 5, 300, buzzer);
+    sound_play(&game_start_melody, buzzer, true);
 }
 
-//the below array holds the scores for red team (index 0) and blue team (index 1)
-int scores[] = {0, 0};
-unsigned long starting_ticks; //at the very start of the program
-unsigned long ticks_at_entry = 0;
-unsigned long ms_elapsed;
-
-//Handler function for when an IR sensor is triggered/beam crossed.
-//A hoop struct pointer is passed in for aux_data.
-static void handle_entry(void *aux_data) {
-    struct hoop *cur_hoop = (struct hoop *)aux_data;
-    gpio_interrupt_clear(cur_hoop->IR_sensor);
-
-    //delay for start of program since it seemingly treats turning on as a positive edge
-    if ( (((timer_get_ticks() - starting_ticks) / 24) / (1000)) < 200) {
-        uart_putchar('h');
-        return;
+//the below array holds the score of each team, indexed like teams
+int scores[NUM_TEAMS];
+
+#define GAME_SECS 90
+#define TEAM_SWAP_SECS 5
+
+//Scores the transits that finished on one hoop since the last call, the sensors' handlers
+//only queue edges. Called from the main loop, so it is free to print, play sounds and update displays.
+static void process_shots(struct hoop *cur_hoop) {
+    scoring_shot_t shot;
+
+    while (hoop_sensor_poll(&cur_hoop->sensor, &shot)) {
+        evtrace_record(EVT_SHOT, cur_hoop->index, shot.result << 8 | shot.points, shot.transit_ticks);
+        DLOG("hoop %d %s, transit ms: %ld\n", cur_hoop->index + 1, scoring_result_name(shot.result),
+             (long)systime_ticks_to_ms(shot.transit_ticks));
+        if (shot.points == 0) {
+            continue; //bounced out, went up through the hoop or a jitter/misread
+        }
+        scores[cur_hoop->team] += shot.points;
+        evtrace_record(EVT_SCORE, cur_hoop->team, 0, scores[cur_hoop->team]);
+        if (shot.points == 2) {
+            play_2point_sound(cur_hoop->config->buzzer);
+        }
+        else {
+            play_1point_sound(cur_hoop->config->buzzer);
+        }
+        display_num(&cur_hoop->scoreboard, scores[cur_hoop->team]);
+        if (cur_hoop->config->strip != NO_STRIP) animation_score_flash(cur_hoop->config->strip, COLOR(0xFF, 0xFF, 0xFF));
+        //the above displays the score for the team that the current hoop is for at the time,
+        //on that hoops scoreboard
     }
+}
 
-    ticks_at_entry = timer_get_ticks();
+//State of the game shared by the tasks below, which main hands to the scheduler. Each task
+//runs to completion and anything that has to wait comes back on a timer.
+static struct {
+    int mode;
+    mode_select_t selector;
+    struct hoop hoops[NUM_HOOPS];
+    Countdown clock;
+    scheduler_timer_t select_timer, intro_timer, clock_timer, shot_timer, swap_timer, end_timer;
+} game;
+
+#define POLL_MS 10 //how often the button and the end of sounds are checked
+#define LOG_LINES_PER_PASS 2 //deferred log lines printed between tasks, keeps uart time per pass short
+
+static void start_game(void);
+static void end_game(void);
+
+//Sets the base layer of a hoop's LED strip, if it has one, to its team's color
+static void animate_hoop(struct hoop *cur_hoop, animation_effect_t effect, int period_ms) {
+    if (cur_hoop->config->strip == NO_STRIP) return;
+    animation_set(cur_hoop->config->strip, ANIMATION_LAYER_BASE, effect, teams[cur_hoop->team].color, period_ms, 0);
+}
 
-    while (gpio_read(cur_hoop->IR_sensor) != 0) {}
-    ms_elapsed = ((timer_get_ticks() - ticks_at_entry) / 24) / (1000);
-    printf("ms elapsed: %ld ", ms_elapsed);
+//Updates the LED strips and score displays to match the current team of each hoop
+static void show_teams(void) {
+    DisplayConfig *scoreboards[NUM_HOOPS];
+    int hoop_scores[NUM_HOOPS];
+    for (int i = 0; i < NUM_HOOPS; i++) {
+        animate_hoop(&game.hoops[i], ANIM_SOLID, 0);
+        scoreboards[i] = &game.hoops[i].scoreboard;
+        hoop_scores[i] = scores[game.hoops[i].team];
+    }
+    //the strips change on the next animation frame
+    display_num_many(scoreboards, hoop_scores, NUM_HOOPS);
+    //the above updates the score displays for all hoops in one pass
+}
 
-    if (ms_elapsed < 10) {
-        return; //give no points, probably a jitter/misread
+//Scores the shots on every hoop, runs every millisecond during the game
+static void shot_task(void *aux_data) {
+    for (int i = 0; i < NUM_HOOPS; i++) {
+        process_shots(&game.hoops[i]);
     }
-    else if (ms_elapsed < 65) {
-        scores[cur_hoop->team] += 2; //add 2
-        play_2point_sound(buzzer_1);
-        //rb_enqueue(cur_hoop->ring_buf, 1);
+}
+
+//mode 2 moves every hoop on to the next team in team_rotation (shown by score displays and
+//LED switching), mode 1 is default mode, hoop teams stay constant
+static void swap_task(void *aux_data) {
+    uint32_t packed_teams = 0;
+    for (int i = 0; i < NUM_HOOPS; i++) {
+        game.hoops[i].team = team_rotation[game.hoops[i].team];
+        packed_teams |= game.hoops[i].team << (4 * i);
     }
-    else {
-        scores[cur_hoop->team]++; //add 1
-        play_1point_sound(buzzer_1);
-        //rb_enqueue(cur_hoop->ring_buf, 2);
+    evtrace_record(EVT_TEAM_SWAP, NUM_HOOPS, 0, packed_teams);
+    show_teams();
+}
+
+//Redraws the game clock and comes back when the shown second next changes
+static void clock_task(void *aux_data) {
+    if (!countdown_update(&game.clock)) {
+        end_game();
+        return;
     }
-    display_num(cur_hoop->scoreboard, scores[cur_hoop->team]);
-    //the above displays the score for the team that the current hoop is for at the time,
-    //on that hoops scoreboard
+    long remaining_ms = countdown_remaining_ms(&game.clock);
+    scheduler_timer_start(&game.clock_timer, (remaining_ms - 1) % 1000 + 1, 0, clock_task, NULL);
+}
+
+//The game begins when the start sound ends, strips chase until then
+static void intro_task(void *aux_data) {
+    if (sound_is_playing()) return;
+    scheduler_timer_stop(&game.intro_timer);
+    start_game();
 }
 
-//Triggers however often we set it when registering,
-//used for switching the team of the hoops. A hoops_in_game struct pointer
-//is passed in for aux_data.
-static void handle_timer_interrupt(void *aux_data) {
-    hstimer_interrupt_clear(HSTIMER0);
-    struct hoops_in_game *cur_game_hoops = (struct hoops_in_game *)aux_data;
-    cur_game_hoops->hoop1->team = ~(cur_game_hoops->hoop1->team & 1) + 2;
-    cur_game_hoops->hoop2->team = ~(cur_game_hoops->hoop2->team & 1) + 2;
-    //the above switches the team values between 0 and 1 (bit flips them)
-
-    // printf("%d", cur_game_hoops->hoop1->team);
-    // printf("%d", cur_game_hoops->hoop2->team);
-
-    if (cur_game_hoops->hoop1->team) {
-        //if hoop1 has a team value of 1 (blue team) then display blue for it
-        display_color(NULL, nleds, 0x00, 0x00, 0xFF, false); // solid blue color on led strip 1
-        display_color(&strip2, nleds, 0xFF, 0x00, 0x00, true); // solid red color on led strip 2
+//Polls the button until a mode is selected, then plays the start sound
+static void select_task(void *aux_data) {
+    int mode = button_mode_select_poll(&game.selector);
+    if (mode == 0) return;
+    game.mode = mode;
+    scheduler_timer_stop(&game.select_timer);
+
+    display_countdown(&countdown_timer, GAME_SECS / 60, GAME_SECS % 60);
+    play_game_start(buzzer_1);
+    for (int i = 0; i < NUM_HOOPS; i++) {
+        animate_hoop(&game.hoops[i], ANIM_CHASE, 100);
     }
-    else {
-        //if hoop1 has a team value of 0 (red team) then display red for it
-        display_color(NULL, nleds, 0xFF, 0x00, 0x00, false); // solid red color on led strip 1
-        display_color(&strip2, nleds, 0x00, 0x00, 0xFF, true); // solid blue color on led strip 2
+    scheduler_timer_start(&game.intro_timer, POLL_MS, POLL_MS, intro_task, NULL);
+}
+
+static void start_game(void) {
+    show_teams();
+    for (int i = 0; i < NUM_HOOPS; i++) {
+        hoop_sensor_discard(&game.hoops[i].sensor); //shots taken before the start sound ends do not count
+    }
+    if (game.mode == 3) {
+        ir_trace_start();
+        irq_stats_reset(); //the dump at the end covers the game only
     }
 
-    display_num(cur_game_hoops->hoop1->scoreboard, scores[cur_game_hoops->hoop1->team]);
-    display_num(cur_game_hoops->hoop2->scoreboard, scores[cur_game_hoops->hoop2->team]);
-    //the above updates the score displays for each hoop
+    //the countdown redraws itself once per second while shots are scored every millisecond
+    countdown_init(&game.clock, &countdown_timer, GAME_SECS / 60, GAME_SECS % 60);
+    countdown_set_callbacks(&game.clock, warn_final_ten, NULL, NULL);
+    countdown_start(&game.clock);
+    clock_task(NULL);
+    scheduler_timer_start(&game.shot_timer, 1, 1, shot_task, NULL);
+    if (game.mode == 2) {
+        scheduler_timer_start(&game.swap_timer, TEAM_SWAP_SECS * 1000, TEAM_SWAP_SECS * 1000, swap_task, NULL);
+    }
 }
 
-//for another gpio pin attached to the same IR sensor - not used in current version
-// static void handle_exit(void *aux_data) {
-//     ms_elapsed = ((timer_get_ticks() - start_ticks) / 24) / (1000);
+//Idle hook of the event loop, prints the messages queued with DLOG
+static void log_task(void *aux_data) {
+    dlog_drain(LOG_LINES_PER_PASS);
+}
 
-//     struct hoop *cur_hoop = (struct hoop *)aux_data;
-//     gpio_interrupt_clear(cur_hoop->IR_sensor);
-//     scores[cur_hoop->team]++; //add 1
+//Waits for the win flash, win sound and displays to finish, then ends the event loop
+static void end_task(void *aux_data) {
+    if (animation_busy() || sound_is_playing() || display_tx_busy() || dotstar_busy()) return;
+    scheduler_timer_stop(&game.end_timer);
+    while (dlog_drain(DLOG_QUEUE_LEN)) {}
+    if (game.mode == 3) {
+        ir_trace_dump();
+        irq_stats_dump();
+        evtrace_dump();
+    }
+    uart_tx_flush(); //the summary goes out before main returns
+    scheduler_stop();
+}
 
-// }
+static void end_game(void) {
+    scheduler_timer_stop(&game.shot_timer);
+    scheduler_timer_stop(&game.swap_timer);
+    for (int i = 0; i < NUM_HOOPS; i++) {
+        hoop_sensor_disable(&game.hoops[i].sensor);
+    }
+    ir_trace_stop();
+    shot_task(NULL); //score shots that finished just before time ran out
+    play_win_sound(buzzer_1);
+    int winner = 0, leaders = 0;
+    for (int team = 0; team < NUM_TEAMS; team++) {
+        if (scores[team] > scores[winner]) {
+            winner = team;
+            leaders = 0;
+        }
+        if (scores[team] == scores[winner]) leaders++;
+    }
+    led_t win_color;
+    if (leaders == 1) {
+        uart_tx_printf("%s wins\n", teams[winner].name);
+        win_color = teams[winner].color;
+    }
+    else {
+        uart_tx_printf("TIE\n");
+        win_color = COLOR(0xFF, 0x00, 0xFF); //purple
+    }
+    //the below flashes the winning color on both LEDs 3 times (off 750 ms, on 750 ms)
+    for (int strip = 0; strip < ANIMATION_STRIPS; strip++) {
+        animation_set(strip, ANIMATION_LAYER_BASE, ANIM_SOLID, win_color, 0, 0);
+        animation_set(strip, ANIMATION_LAYER_OVERLAY, ANIM_NONE, COLOR(0, 0, 0), 0, 0);
+        animation_set(strip, ANIMATION_LAYER_FLASH, ANIM_FLASH, COLOR(0x00, 0x00, 0x00), 1500, 3 * 1500);
+    }
+    scheduler_timer_start(&game.end_timer, POLL_MS, POLL_MS, end_task, NULL);
+}
 
 void main(void) {
-    starting_ticks = timer_get_ticks(); //exists to handle the false interrupt at program start
     gpio_init();
     timer_init();
     uart_init();
     printf("\nStarting main() in %s\n", __FILE__);
     interrupts_init();
     say_hello("CS107e");
-    printf("hi");
-    printf("looping");
-    //should all be handled in IR module - actually BEN said not needed
-    gpio_set_input(sensor_1);
-    gpio_set_input(sensor_2);
-    gpio_set_output(buzzer_1);
-    gpio_set_output(buzzer_2);
-    rb_t *rb1 = rb_new();
-    rb_t *rb2 = rb_new();
-
-    display_init(&team1_scoreboard, clock_team_1, DIO_team_1, 100);
-    display_init(&team2_scoreboard, clock_team_2, DIO_team_2, 100);
-    display_num(&team1_scoreboard, 0);
-    display_num(&team2_scoreboard, 0);
-    display_init(&countdown_timer, clock_countdown, DIO_countdown, 100);
-
-    spi_init(SPI_MODE_0);
+    for (int i = 0; i < NUM_HOOPS; i++) {
+        struct hoop *cur_hoop = &game.hoops[i];
+        cur_hoop->config = &hoop_configs[i];
+        cur_hoop->team = cur_hoop->config->team;
+        cur_hoop->index = i;
+        gpio_set_output(cur_hoop->config->buzzer);
+        display_init(&cur_hoop->scoreboard, cur_hoop->config->display_clock, cur_hoop->config->display_dio,
+                     DISPLAY_BITDELAY_AUTO);
+    }
+    display_init(&countdown_timer, clock_countdown, DIO_countdown, DISPLAY_BITDELAY_AUTO);
+
+    scheduler_init();
+    spi_init(SPI_MODE_0, LED_SPI_HZ);
+    dotstar_init(nleds); //strip 1 frames go out over DMA from here on
     spi2_init(&strip2, strip2_mosi, strip2_sclk);
-    display_color(NULL, nleds, 0xFF, 0x00, 0x00, false); // solid red color on led strip 1
-    display_color(&strip2, nleds, 0x00, 0x00, 0xFF, true); // solid blue color on led strip 2
+    animation_init(&strip2, nleds, LED_FPS);
 
-    struct hoop first_hoop = {RED, sensor_1, buzzer_1, rb1, &team1_scoreboard}; 
-    struct hoop second_hoop = {BLUE, sensor_2, buzzer_2, rb2, &team2_scoreboard};
-    struct hoops_in_game game_hoops = {&first_hoop, &second_hoop};
+    show_teams(); //zero scores, each hoop's strip in its team's color
+    animation_update();
 
     gpio_interrupt_init();
-    gpio_interrupt_config(sensor_1, GPIO_INTERRUPT_POSITIVE_EDGE, true);
-    gpio_interrupt_register_handler(sensor_1, handle_entry, &first_hoop);
-    gpio_interrupt_enable(sensor_1);
-    gpio_interrupt_config(sensor_2, GPIO_INTERRUPT_POSITIVE_EDGE, true);
-    gpio_interrupt_register_handler(sensor_2, handle_entry, &second_hoop);
-    gpio_interrupt_enable(sensor_2);
-    hstimer_init(HSTIMER0, 5000000);
-    interrupts_register_handler(INTERRUPT_SOURCE_HSTIMER0, handle_timer_interrupt, &game_hoops);
-    interrupts_enable_source(INTERRUPT_SOURCE_HSTIMER0);
-
-    timer_delay_ms(500);
-    button_init(button);
-    int mode = button_mode_select(&countdown_timer, button, 2);
-
-    display_countdown(&countdown_timer, 1, 30);
-    play_game_start(buzzer_1);
-
-    if (mode == 2) {
-        hstimer_enable(HSTIMER0); //this then enables the mode where the
-        //teams switch between hoops (shown by score displays and LED switching)
-        //mode 1 is default mode, hoop teams stay constant
+    //edges in the first 200 ms are ignored, the receivers seem to report one as they power up.
+    //Each beam's handler gets its own beam as aux data, so an edge goes straight to its hoop.
+    for (int i = 0; i < NUM_HOOPS; i++) {
+        struct hoop *cur_hoop = &game.hoops[i];
+        hoop_sensor_init(&cur_hoop->sensor, cur_hoop->config->rim_sensor, cur_hoop->config->net_sensor, i);
     }
+    sound_init();
+    uart_tx_init(); //console output is buffered from here on
     interrupts_global_enable();
-    start_countdown(&countdown_timer, 1, 30);
-    printf("ttt");
-    gpio_interrupt_disable(sensor_1);
-    gpio_interrupt_disable(sensor_2);
-    hstimer_disable(HSTIMER0);
-    play_win_sound(buzzer_1);
-    if (scores[0] > scores[1]) {
-        printf("red wins");
-        //the below flashes red on both LEDs 3 times
-        for (int i = 0; i < 3; i++) {
-            display_color(NULL, nleds, 0x00, 0x00, 0x00, false); // LED STRIP 1 OFF
-            display_color(&strip2, nleds, 0x00, 0x00, 0x00, true); // LED STRIP 2 OFF
-            timer_delay_ms(500);
-            display_color(NULL, nleds, 0xFF, 0x00, 0x00, false); // solid red color on led strip 1
-            display_color(&strip2, nleds, 0xFF, 0x00, 0x00, true); // solid red color on led strip 2
-            timer_delay_ms(1000);
-        }
-    }
-    else if (scores[1] > scores[0]){
-        printf("Blue wins");
-        //the below flashes blue on both LEDs 3 times
-        for (int i = 0; i < 3; i++) {
-            display_color(NULL, nleds, 0x00, 0x00, 0x00, false); // LED STRIP 1 OFF
-            display_color(&strip2, nleds, 0x00, 0x00, 0x00, true); // LED STRIP 2 OFF
-            timer_delay_ms(500);
-            display_color(NULL, nleds, 0x00, 0x00, 0xFF, false); // solid red color on led strip 1
-            display_color(&strip2, nleds, 0x00, 0x00, 0xFF, true); // solid red color on led strip 2
-            timer_delay_ms(1000);
-        }
-    }
-    else {
-        printf("TIE");
-        //the below flashes purple on both LEDs 3 times
-        for (int i = 0; i < 3; i++) {
-            display_color(NULL, nleds, 0x00, 0x00, 0x00, false); // LED STRIP 1 OFF
-            display_color(&strip2, nleds, 0x00, 0x00, 0x00, true); // LED STRIP 2 OFF
-            timer_delay_ms(500);
-            display_color(NULL, nleds, 0xFF, 0x00, 0xFF, false); // solid purple color on led strip 1
-            display_color(&strip2, nleds, 0xFF, 0x00, 0xFF, true); // solid purple color on led strip 2
-            timer_delay_ms(1000);
-        }
-    }
+    display_tx_init(HSTIMER0); //from here on the displays update in the background
+
+    //mode select starts after 500 ms, from there on everything runs from the event loop:
+    //mode select, the start sound, the game and the win flash, see the tasks above
+    button_init(button);
+    button_mode_select_start(&game.selector, &countdown_timer, button, 3);
+    scheduler_timer_start(&game.select_timer, 500, POLL_MS, select_task, NULL);
+    scheduler_set_idle(log_task, NULL);
+    scheduler_run();
 }
@@ -0,0 +1,120 @@
+/* File: scheduler.c
+ * -------------
+ * Event loop and hashed timer wheel, see scheduler.h.
+ */
+
+#include "scheduler.h"
+#include "strings.h"
+
+#define SLOT_MASK (SCHEDULER_SLOTS - 1)
+#define POST_MASK (SCHEDULER_POST_LEN - 1)
+
+static struct {
+    scheduler_timer_t *slots[SCHEDULER_SLOTS]; // slot i holds the timers with expire_ms % SLOTS == i
+    uint64_t current_ms; // next millisecond the wheel has not processed
+    struct {
+        task_fn_t fn;
+        void *aux_data;
+    } posted[SCHEDULER_POST_LEN];
+    unsigned int head, tail;
+    bool running;
+    task_fn_t idle_fn;
+    void *idle_aux_data;
+} sched;
+
+void scheduler_init(void) {
+    memset(&sched, 0, sizeof(sched));
+    sched.current_ms = systime_ms();
+}
+
+static void insert(scheduler_timer_t *t) {
+    scheduler_timer_t **slot = &sched.slots[t->expire_ms & SLOT_MASK];
+    t->next = *slot;
+    *slot = t;
+    t->armed = true;
+}
+
+static void remove_timer(scheduler_timer_t *t) {
+    for (scheduler_timer_t **p = &sched.slots[t->expire_ms & SLOT_MASK]; *p; p = &(*p)->next) {
+        if (*p == t) {
+            *p = t->next;
+            break;
+        }
+    }
+    t->armed = false;
+}
+
+void scheduler_timer_start(scheduler_timer_t *t, int delay_ms, int period_ms, task_fn_t fn, void *aux_data) {
+    if (t->armed) remove_timer(t);
+    t->expire_ms = systime_ms() + (delay_ms > 0 ? delay_ms : 0);
+    if (t->expire_ms < sched.current_ms) t->expire_ms = sched.current_ms;
+    t->period_ms = period_ms > 0 ? period_ms : 0;
+    t->fn = fn;
+    t->aux_data = aux_data;
+    insert(t);
+}
+
+void scheduler_timer_stop(scheduler_timer_t *t) {
+    if (t->armed) remove_timer(t);
+}
+
+// First timer in the slot that is due by now_ms, slots also hold timers for later turns
+static scheduler_timer_t *first_due(scheduler_timer_t *t, uint64_t now_ms) {
+    while (t && t->expire_ms > now_ms) t = t->next;
+    return t;
+}
+
+// Runs the timers due by now_ms. Each one is unlinked (and a periodic one put back) before
+// it runs, so a task is free to start or stop any timer including its own.
+static void advance(uint64_t now_ms) {
+    if (now_ms >= sched.current_ms && now_ms - sched.current_ms >= SCHEDULER_SLOTS) {
+        sched.current_ms = now_ms - SCHEDULER_SLOTS + 1; // one full turn still visits every slot
+    }
+    for (; sched.current_ms <= now_ms; sched.current_ms++) {
+        scheduler_timer_t *t;
+        while ((t = first_due(sched.slots[sched.current_ms & SLOT_MASK], now_ms)) != NULL) {
+            remove_timer(t);
+            if (t->period_ms) {
+                t->expire_ms += t->period_ms;
+                if (t->expire_ms <= now_ms) t->expire_ms = now_ms + t->period_ms; // fell behind, skip
+                insert(t);
+            }
+            t->fn(t->aux_data);
+        }
+    }
+}
+
+bool scheduler_post(task_fn_t fn, void *aux_data) {
+    if (sched.tail - sched.head == SCHEDULER_POST_LEN) return false;
+    sched.posted[sched.tail & POST_MASK].fn = fn;
+    sched.posted[sched.tail & POST_MASK].aux_data = aux_data;
+    sched.tail++;
+    return true;
+}
+
+void scheduler_run_once(void) {
+    advance(systime_ms());
+
+    // only the tasks already posted, one that posts itself again runs on the next pass
+    for (unsigned int n = sched.tail - sched.head; n > 0; n--) {
+        unsigned int slot = sched.head++ & POST_MASK;
+        sched.posted[slot].fn(sched.posted[slot].aux_data);
+    }
+}
+
+void scheduler_run(void) {
+    sched.running = true;
+    while (sched.running) {
+        scheduler_run_once();
+        if (sched.idle_fn) sched.idle_fn(sched.idle_aux_data);
+    }
+}
+
+void scheduler_set_idle(task_fn_t fn, void *aux_data) {
+    sched.idle_fn = fn;
+    sched.idle_aux_data = aux_data;
+}
+
+void scheduler_stop(void) {
+    sched.running = false;
+}
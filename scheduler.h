@@ -0,0 +1,57 @@
+/* File: scheduler.h
+ * -------------
+ * Run-to-completion event loop for the main program. Work is either posted to run on the
+ * next pass of the loop or put on a timer that runs it once or periodically. Tasks run one
+ * at a time in the main loop, never in an interrupt, and must return quickly: anything that
+ * waits is split into a timer that comes back later.
+ *
+ * Timers live in a hashed timer wheel of SCHEDULER_SLOTS one-millisecond slots on the 64-bit
+ * system timer (systime.h), so starting, stopping and expiring a timer costs the same no
+ * matter how many are armed. Timers further out than one turn of the wheel wait in their
+ * slot for later turns.
+ */
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include "systime.h"
+#include <stdbool.h>
+
+#define SCHEDULER_SLOTS 64       // power of two
+#define SCHEDULER_POST_LEN 16    // posted tasks waiting for the next pass, power of two
+
+typedef void (*task_fn_t)(void *aux_data);
+
+// A timer is owned by the caller and must stay in place while it is armed
+typedef struct scheduler_timer {
+    struct scheduler_timer *next; // in its wheel slot
+    uint64_t expire_ms;
+    uint32_t period_ms;           // 0 for a one-shot timer
+    bool armed;
+    task_fn_t fn;
+    void *aux_data;
+} scheduler_timer_t;
+
+void scheduler_init(void);
+
+// Runs fn(aux_data) once after delay_ms, then every period_ms unless period_ms is 0.
+// Restarting an armed timer moves it.
+void scheduler_timer_start(scheduler_timer_t *t, int delay_ms, int period_ms, task_fn_t fn, void *aux_data);
+
+void scheduler_timer_stop(scheduler_timer_t *t);
+
+// Runs fn(aux_data) on the next pass of the loop. Only from the main loop, not from interrupt
+// handlers. Returns false if the queue is full and the task was dropped.
+bool scheduler_post(task_fn_t fn, void *aux_data);
+
+// Runs every expired timer and every posted task once
+void scheduler_run_once(void);
+
+// Runs the loop until scheduler_stop is called from a task
+void scheduler_run(void);
+
+// fn(aux_data) runs after every pass of the loop, for background work such as log output
+void scheduler_set_idle(task_fn_t fn, void *aux_data);
+
+void scheduler_stop(void);
+
+#endif
@@ -0,0 +1,54 @@
+/* File: scoring.c
+ * -------------
+ * Two-sensor transit fusion and shot classification, see scoring.h.
+ */
+
+#include "scoring.h"
+
+#define MS(ms) ((systime_t)(ms) * SYSTIME_TICKS_PER_MS)
+
+void scoring_fusion_reset(scoring_fusion_t *f) {
+    f->state = SCORING_IDLE;
+    f->broken[SCORING_TOP] = f->broken[SCORING_BOTTOM] = false;
+}
+
+static bool finish(scoring_fusion_t *f, scoring_result_t result, systime_t transit, scoring_shot_t *shot) {
+    shot->result = result;
+    shot->points = (result != SCORING_SCORED) ? 0 : (transit < MS(SCORING_SWISH_TRANSIT_MS)) ? 2 : 1;
+    shot->start_ticks = f->since_ticks;
+    shot->transit_ticks = transit;
+    f->state = SCORING_IDLE;
+    return true;
+}
+
+bool scoring_fuse_edge(scoring_fusion_t *f, scoring_sensor_t sensor, int level, systime_t ticks, scoring_shot_t *shot) {
+    bool was_broken = f->broken[sensor];
+    f->broken[sensor] = level;
+    if (!level || was_broken) return false; // only a new break moves the state
+
+    systime_t elapsed = ticks - f->since_ticks;
+    switch (f->state) {
+    case SCORING_IDLE:
+        f->state = (sensor == SCORING_TOP) ? SCORING_ENTERED : SCORING_EXITED_FIRST;
+        f->since_ticks = ticks;
+        return false;
+    case SCORING_ENTERED:
+        if (sensor == SCORING_TOP) return false; // rattling around the rim, still the same ball
+        return finish(f, elapsed < MS(SCORING_MIN_TRANSIT_MS) ? SCORING_JITTER : SCORING_SCORED, elapsed, shot);
+    case SCORING_EXITED_FIRST:
+        if (sensor == SCORING_BOTTOM) return false;
+        return finish(f, elapsed < MS(SCORING_MIN_TRANSIT_MS) ? SCORING_JITTER : SCORING_UPWARD, elapsed, shot);
+    }
+    return false;
+}
+
+bool scoring_fuse_timeout(scoring_fusion_t *f, systime_t now, scoring_shot_t *shot) {
+    // signed, a now read before the break was queued must not count as a timeout
+    if (f->state == SCORING_IDLE || systime_reached(f->since_ticks + MS(SCORING_MAX_TRANSIT_MS), now)) return false;
+    return finish(f, f->state == SCORING_ENTERED ? SCORING_BOUNCE_OUT : SCORING_NO_ENTRY, 0, shot);
+}
+
+const char *scoring_result_name(scoring_result_t result) {
+    static const char *names[] = {"scored", "jitter", "upward", "bounce-out", "no entry"};
+    return names[result];
+}
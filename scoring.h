@@ -0,0 +1,69 @@
+/* File: scoring.h
+ * -------------
+ * Shot detection shared by the game (through hoop_sensor.c) and the host replay tool
+ * (host/replay.c). Each hoop has two IR sensors, one at the rim (top) and one under the
+ * net (bottom). scoring_fuse_edge is fed both sensors' edges in time order and pairs the
+ * top and bottom breaks into one ball transit:
+ *   top then bottom     a made shot, a fast transit (swish) is worth 2, a slow one 1
+ *   bottom then top     the ball went up through the hoop, rejected
+ *   top only            the ball bounced out of the rim, rejected once it times out
+ *   bottom only         something came from below, rejected once it times out
+ *   both at once        jitter (a hand, a light flicker), rejected
+ */
+#ifndef _SCORING_H
+#define _SCORING_H
+
+#include "systime.h"
+#include <stdbool.h>
+
+// The thresholds come from the ball falling the gap between the beams, about 30 cm from the
+// rim sensor to the one under the net. From an entry speed v it takes t with
+// 0.3 m = v*t + g*t*t/2:
+//   v = 10 m/s (harder than any throw)   29 ms, so under 3 ms both beams broke on one
+//                                        disturbance, the ball is too small to block both
+//   v = 3 m/s (a clean shot's drop)      88 ms, a ball that touched the rim has lost most
+//                                        of its speed and takes longer, hence the swish line
+//   v = 0 (rolled off the rim)           250 ms in free fall, the net roughly doubles it,
+//                                        750 ms leaves margin before calling a bounce-out
+// They scale with the gap, check them against a recorded game with host/replay, which prints
+// every transit's time.
+#define SCORING_MIN_TRANSIT_MS 3
+#define SCORING_SWISH_TRANSIT_MS 100 // faster transits are swishes worth 2
+#define SCORING_MAX_TRANSIT_MS 750   // longer without the other sensor is a bounce-out
+
+typedef enum { SCORING_TOP = 0, SCORING_BOTTOM = 1 } scoring_sensor_t;
+
+typedef enum {
+    SCORING_SCORED,
+    SCORING_JITTER,
+    SCORING_UPWARD,
+    SCORING_BOUNCE_OUT,
+    SCORING_NO_ENTRY,
+} scoring_result_t;
+
+typedef struct {
+    scoring_result_t result;
+    int points;                 // 0 unless scored
+    systime_t start_ticks;   // first sensor's break
+    systime_t transit_ticks; // from the first break to the other sensor's, 0 if none
+} scoring_shot_t;
+
+typedef struct {
+    enum { SCORING_IDLE, SCORING_ENTERED, SCORING_EXITED_FIRST } state;
+    systime_t since_ticks; // break that started the state
+    bool broken[2];
+} scoring_fusion_t;
+
+void scoring_fusion_reset(scoring_fusion_t *f);
+
+// Feeds one edge, level is the sensor reading after it (1 while the beam is broken).
+// Returns true when the edge completes a transit, which is then described by *shot.
+bool scoring_fuse_edge(scoring_fusion_t *f, scoring_sensor_t sensor, int level, systime_t ticks, scoring_shot_t *shot);
+
+// Returns true if a half-finished transit has waited past SCORING_MAX_TRANSIT_MS by now,
+// with the rejection in *shot. Call before feeding each edge and while idle.
+bool scoring_fuse_timeout(scoring_fusion_t *f, systime_t now, scoring_shot_t *shot);
+
+const char *scoring_result_name(scoring_result_t result);
+
+#endif
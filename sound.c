@@ -2,41 +2,182 @@
  * -------------
  * Author: John Carlson
  * Implementation of module for playing sounds via notes, repurposed from Assignment 2.
+ * Melodies passed to sound_play are played in the background: HSTIMER1 fires once
+ * per half-period of the current note and its handler toggles the buzzer, so the
+ * caller never waits on the music.
  */
 #include "sound.h"
 #include "gpio.h"
 #include "timer.h"
+#include "hstimer.h"
+#include "irq_stats.h"
+#include "evtrace.h"
+#include "hal.h"
+#include <stddef.h>
+
+#define NOTE_GAP_US 50000 // silence after each note
+#define NOTE_GAP_TICKS (NOTE_GAP_US * SOUND_TICKS_PER_US)
+#define SOUND_QUEUE_LEN 4
+
+typedef struct {
+    const melody_t *melody;
+    gpio_id_t buzzer;
+} queued_melody_t;
+
+static struct {
+    queued_melody_t queue[SOUND_QUEUE_LEN]; // melodies waiting behind the current one
+    int head, count;
+    const melody_t *volatile melody; // currently playing, NULL when idle
+    gpio_id_t buzzer;
+    int note_index;
+    int half_cycles_left; // buzzer toggles left in the current note
+    bool in_gap;          // true while the silence after a note is timed
+    int level;
+} player;
+
+//Plays a tone by sending an oscillating voltage through buzzer. Every edge is scheduled
+//from the previous deadline rather than from when the loop got there, so the time spent
+//in gpio_write never accumulates into the pitch or the note length.
+void play_tone(const tone_t *tone, gpio_id_t buzzer) {
+    systime_t deadline = systime_now();
+
+    for (uint32_t i = 0; i < tone->half_cycles; i++) {
+        gpio_write(buzzer, !(i & 1));
+        deadline += tone->half_period_ticks;
+        systime_wait_until(deadline);
+    }
+    gpio_write(buzzer, 0);
+    if (tone->half_period_ticks == 0) {
+        deadline += tone->duration_ticks; // rest
+    }
+    systime_wait_until(deadline + NOTE_GAP_TICKS); // to separate notes very slightly
+}
+
+void play_melody(const melody_t *melody, gpio_id_t buzzer) {
+    for (int i = 0; i < melody->num_tones; i++) {
+        play_tone(&melody->tones[i], buzzer);
+    }
+}
 
 //Plays a note by sending an oscillating voltage from PB0 through buzzer
 void play_note(int base_freq_100x, int note_time, int octave, int bpm, gpio_id_t buzzer) {
-    //1 quarter note gets a beat
-    //scale by 1000000 to act like double later
-    int secs_per_sixteenth = 1000000 / (  (bpm * 4) / 60 );
-    unsigned long milliseconds_elapsed = 0;
-    int frequency_100x = base_freq_100x << octave;
-    unsigned long start_ticks = timer_get_ticks();
-    
-        while (milliseconds_elapsed * 1000000 < (secs_per_sixteenth * note_time * 1000)) {
-            milliseconds_elapsed = ((timer_get_ticks() - start_ticks) / 24) / 1000;
-            gpio_write(buzzer, 1);
-            timer_delay_us( (1000000 * 100 ) / (2 * frequency_100x) );
-            gpio_write(buzzer, 0);
-            timer_delay_us( (1000000 * 100 ) / (2 * frequency_100x) );
-        }
-timer_delay_ms(50); // to separate notes very slightly
+    tone_t tone = TONE(base_freq_100x, note_time, octave, bpm);
+    play_tone(&tone, buzzer);
 }
 
 //Simply a delay where no note is played
 void play_rest(int rest_time, int bpm, gpio_id_t buzzer) {
-    //1 quarter note gets a beat
-    //scale by 1000000 to act like double later
-    int secs_per_sixteenth = 1000000 / (  (bpm * 4) / 60 );
-    unsigned long milliseconds_elapsed = 0;
-    unsigned long start_ticks = timer_get_ticks();
-
-        while (milliseconds_elapsed * 1000000 < (secs_per_sixteenth * rest_time * 1000)) {
-            milliseconds_elapsed = ((timer_get_ticks() - start_ticks) / 24) / 1000;
-            gpio_write(buzzer, 0);
-    }
-timer_delay_ms(50); // to separate notes slightly
-}
\ No newline at end of file
+    tone_t tone = REST_TONE(rest_time, bpm);
+    play_tone(&tone, buzzer);
+}
+
+//Restarts HSTIMER1 so it next fires after ticks, to the tick rather than the microsecond
+static void restart_timer(uint32_t ticks) {
+    hstimer_disable(HSTIMER1);
+    hal_hstimer_set_interval(HSTIMER1, ticks);
+    hstimer_enable(HSTIMER1);
+}
+
+//Loads the next step for the player: the gap after a note, the next note, or the next
+//queued melody. Leaves the timer disabled when there is nothing left to play.
+static void advance(void) {
+    gpio_write(player.buzzer, 0);
+    player.level = 0;
+
+    if (!player.in_gap && player.note_index > 0) {
+        player.in_gap = true;
+        player.half_cycles_left = 0;
+        restart_timer(NOTE_GAP_TICKS);
+        return;
+    }
+    player.in_gap = false;
+
+    while (player.note_index == player.melody->num_tones) {
+        if (player.count == 0) {
+            hstimer_disable(HSTIMER1);
+            player.melody = NULL;
+            return;
+        }
+        player.melody = player.queue[player.head].melody;
+        player.buzzer = player.queue[player.head].buzzer;
+        player.head = (player.head + 1) % SOUND_QUEUE_LEN;
+        player.count--;
+        player.note_index = 0;
+    }
+
+    const tone_t *tone = &player.melody->tones[player.note_index];
+    evtrace_record(EVT_NOTE_START, player.note_index++, 0, tone->half_period_ticks);
+    player.half_cycles_left = tone->half_cycles;
+    restart_timer(tone->half_period_ticks ? tone->half_period_ticks : tone->duration_ticks);
+}
+
+static void handle_sound_timer(void *aux_data) {
+    hstimer_interrupt_clear(HSTIMER1);
+    if (player.melody == NULL) {
+        hstimer_disable(HSTIMER1);
+        return;
+    }
+    if (player.half_cycles_left > 0) {
+        player.level = !player.level;
+        gpio_write(player.buzzer, player.level);
+        player.half_cycles_left--;
+        return;
+    }
+    advance();
+}
+
+void sound_init(void) {
+    player.melody = NULL;
+    player.head = player.count = 0;
+    hstimer_init(HSTIMER1, NOTE_GAP_US); //the interval is replaced for every note
+    irq_stats_register_handler(INTERRUPT_SOURCE_HSTIMER1, handle_sound_timer, NULL, "sound");
+    interrupts_enable_source(INTERRUPT_SOURCE_HSTIMER1);
+}
+
+bool sound_play(const melody_t *melody, gpio_id_t buzzer, bool preempt) {
+    bool queued = true;
+    // the timer handler is the only other user of player, keep it out while we edit
+    interrupts_disable_source(INTERRUPT_SOURCE_HSTIMER1);
+
+    if (preempt && player.melody != NULL) {
+        gpio_write(player.buzzer, 0);
+        player.melody = NULL;
+        player.count = 0;
+    }
+
+    if (player.melody == NULL) {
+        player.melody = melody;
+        player.buzzer = buzzer;
+        player.note_index = 0;
+        player.in_gap = false;
+        gpio_set_output(buzzer);
+        advance();
+    }
+    else if (player.count < SOUND_QUEUE_LEN) {
+        int tail = (player.head + player.count) % SOUND_QUEUE_LEN;
+        player.queue[tail].melody = melody;
+        player.queue[tail].buzzer = buzzer;
+        player.count++;
+    }
+    else {
+        queued = false;
+    }
+
+    interrupts_enable_source(INTERRUPT_SOURCE_HSTIMER1);
+    return queued;
+}
+
+bool sound_is_playing(void) {
+    return player.melody != NULL;
+}
+
+void sound_stop(void) {
+    interrupts_disable_source(INTERRUPT_SOURCE_HSTIMER1);
+    hstimer_disable(HSTIMER1);
+    if (player.melody != NULL) {
+        gpio_write(player.buzzer, 0);
+    }
+    player.melody = NULL;
+    player.count = 0;
+    interrupts_enable_source(INTERRUPT_SOURCE_HSTIMER1);
+}
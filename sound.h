@@ -7,8 +7,9 @@
 #define _SOUND_H
 
 #include "gpio.h"
-#include "timer.h"
+#include "systime.h"
 #include "interrupts.h"
+#include <stdint.h>
 
 //octave 0 note frequencies below
 //frequencies multiplied by 100 to essentially act as a double later on
@@ -39,8 +40,59 @@ enum {
     whole = 16
 };
 
+#define SOUND_TICKS_PER_US SYSTIME_TICKS_PER_US
+
+//Tone tables below are worked out by the compiler from the enums above, so playing a
+//note needs no division. Periods are in timer ticks to keep the full 24 MHz precision,
+//HSTIMER1 is loaded with them directly. host/tone_test checks them against the old
+//per-note formula, (1000000 * 100) / (2 * frequency_100x) microseconds.
+#define SOUND_SIXTEENTH_US(bpm) (1000000 / (((bpm) * 4) / 60)) //1 quarter note gets a beat
+#define SOUND_DURATION_TICKS(note_time, bpm) \
+    ((uint32_t)SOUND_TICKS_PER_US * SOUND_SIXTEENTH_US(bpm) * (note_time))
+#define SOUND_HALF_PERIOD_TICKS(base_freq_100x, octave) \
+    ((uint32_t)((SOUND_TICKS_PER_US * 1000000ULL * 100) / (2ULL * ((unsigned long long)(base_freq_100x) << (octave)))))
+#define SOUND_HALF_CYCLES(base_freq_100x, note_time, octave, bpm) \
+    ((SOUND_DURATION_TICKS(note_time, bpm) / SOUND_HALF_PERIOD_TICKS(base_freq_100x, octave)) & ~1u)
+
+//One step of a melody, build with TONE or REST_TONE
+typedef struct {
+    uint32_t half_period_ticks; // 0 for a rest
+    uint32_t half_cycles;       // buzzer toggles in the note, always even so it ends low
+    uint32_t duration_ticks;    // length of the note or rest
+} tone_t;
+
+#define TONE(base_freq_100x, note_time, octave, bpm) { \
+    SOUND_HALF_PERIOD_TICKS(base_freq_100x, octave), \
+    SOUND_HALF_CYCLES(base_freq_100x, note_time, octave, bpm), \
+    SOUND_DURATION_TICKS(note_time, bpm) }
+
+#define REST_TONE(rest_time, bpm) {0, 0, SOUND_DURATION_TICKS(rest_time, bpm)}
+
+typedef struct {
+    const tone_t *tones;
+    int num_tones;
+} melody_t;
+
+//Blocking playback, each note is followed by a short silence to separate it from the next
+void play_tone(const tone_t *tone, gpio_id_t buzzer);
+
+void play_melody(const melody_t *melody, gpio_id_t buzzer);
+
 void play_note(int base_freq_100x, int note_time, int octave, int bpm, gpio_id_t buzzer);
 
 void play_rest(int rest_time, int bpm, gpio_id_t buzzer);
 
+//Sets up HSTIMER1 to drive the buzzer in the background, interrupts must already be initialized
+void sound_init(void);
+
+//Starts playing a melody on the buzzer and returns immediately. If preempt is true the current
+//melody and anything queued is cut off, otherwise the melody plays after those already queued.
+//Returns false if the queue is full and the melody was dropped.
+bool sound_play(const melody_t *melody, gpio_id_t buzzer, bool preempt);
+
+bool sound_is_playing(void);
+
+//Silences the buzzer and discards all queued melodies
+void sound_stop(void);
+
 #endif
@@ -7,6 +7,7 @@
  * Date: Mar 5, 2024
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef enum {
@@ -16,9 +17,34 @@ typedef enum {
     SPI_MODE_3,         // CPOL = 1, CPHA = 1 (Clock High, Data Captured on Rising Edge)
 } spi_mode_t;
 
-void spi_init(spi_mode_t mode); // once to init spi module
+// once to init spi module, rate is the bit rate in Hz. The module clock is divided down
+// from the 24 MHz oscillator or the 600 MHz PLL_PERI, whichever gets closest to rate
+// without going over it. Calling it again changes the rate.
+void spi_init(spi_mode_t mode, long rate);
+
+// bit rate actually configured, the fastest the clock dividers allow at or below the rate
+// asked for (or the slowest one there is, for a rate below that)
+long spi_get_rate(void);
 
 // SPI transfer is bi-drectional, same number of bytes transmit as receive
 void spi_transfer(uint8_t *tx, uint8_t *rx, int len);
 
+// Transmit only: sends len bytes from tx as one burst and discards whatever comes back,
+// nothing is read from the RX FIFO
+void spi_write(const uint8_t *tx, int len);
+
+// Starts sending len bytes from tx, fed to the FIFO by DMA, and returns immediately.
+// tx must stay untouched until spi_busy() is false. Received bytes are discarded.
+void spi_write_dma(const uint8_t *tx, int len);
+
+typedef void (*spi_callback_t)(void *aux_data);
+
+// Starts sending len bytes from tx and returns immediately. The TX FIFO is refilled from
+// the SPI1 interrupt, callback (may be NULL) is called from the interrupt handler once the
+// last byte is out. tx must stay untouched until then. Received bytes are discarded.
+// Needs interrupts globally enabled.
+void spi_transfer_start(const uint8_t *tx, int len, spi_callback_t callback, void *aux_data);
+
+bool spi_busy(void);
+
 #endif
\ No newline at end of file
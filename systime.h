@@ -0,0 +1,90 @@
+/* File: systime.h
+ * -------------
+ * Monotonic time for the whole program, built on the 64-bit 24 MHz timer of timer_get_ticks,
+ * which takes over 24000 years to wrap. Timestamps are systime_t ticks. Conversions are
+ * multiplies, ticks to us or ms go through a multiply-high and a shift since the C906 has no
+ * fast divide. Deadlines compare by signed difference, so they stay correct even across a wrap.
+ *
+ * Code that keeps timestamps in 32 bits to save space (queue entries, interrupt handlers)
+ * uses systime32_t, the low half of the tick count. It wraps every 178 s, and the
+ * systime32 helpers are correct for intervals shorter than half of that.
+ */
+#ifndef _SYSTIME_H
+#define _SYSTIME_H
+
+#include "timer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SYSTIME_TICKS_PER_US 24
+#define SYSTIME_TICKS_PER_MS (1000 * SYSTIME_TICKS_PER_US)
+#define SYSTIME_TICKS_PER_SEC (1000000UL * SYSTIME_TICKS_PER_US)
+
+typedef uint64_t systime_t;
+typedef uint32_t systime32_t;
+
+static inline systime_t systime_now(void) {
+    return timer_get_ticks();
+}
+
+static inline systime_t systime_us_to_ticks(uint64_t us) {
+    return us * SYSTIME_TICKS_PER_US;
+}
+
+static inline systime_t systime_ms_to_ticks(uint64_t ms) {
+    return ms * SYSTIME_TICKS_PER_MS;
+}
+
+// ticks / 24 as (ticks / 8) / 3, exact for every 64-bit value
+static inline uint64_t systime_ticks_to_us(systime_t ticks) {
+    return ((unsigned __int128)(ticks >> 3) * 0xAAAAAAAAAAAAAAABULL) >> 65;
+}
+
+// ticks / 24000 as (ticks / 64) / 375, exact for every 64-bit value
+static inline uint64_t systime_ticks_to_ms(systime_t ticks) {
+    return ((unsigned __int128)(ticks >> 6) * 0xAEC33E1F671529A5ULL) >> 72;
+}
+
+static inline uint64_t systime_us(void) {
+    return systime_ticks_to_us(systime_now());
+}
+
+static inline uint64_t systime_ms(void) {
+    return systime_ticks_to_ms(systime_now());
+}
+
+// true once now is at or past deadline
+static inline bool systime_reached(systime_t now, systime_t deadline) {
+    return (int64_t)(now - deadline) >= 0;
+}
+
+static inline bool systime_expired(systime_t deadline) {
+    return systime_reached(systime_now(), deadline);
+}
+
+static inline systime_t systime_deadline_ms(uint64_t ms) {
+    return systime_now() + systime_ms_to_ticks(ms);
+}
+
+static inline systime_t systime_elapsed(systime_t since) {
+    return systime_now() - since;
+}
+
+// Spins until deadline, for waits too short or too precise for the timer_delay functions
+static inline void systime_wait_until(systime_t deadline) {
+    while (!systime_expired(deadline)) {}
+}
+
+static inline systime32_t systime32_now(void) {
+    return (systime32_t)timer_get_ticks();
+}
+
+static inline systime32_t systime32_elapsed(systime32_t since) {
+    return systime32_now() - since;
+}
+
+static inline bool systime32_reached(systime32_t now, systime32_t deadline) {
+    return (int32_t)(now - deadline) >= 0;
+}
+
+#endif
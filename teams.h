@@ -0,0 +1,19 @@
+/* File: teams.h
+ * -------------
+ * The teams as TEAM(id, name, red, green, blue) entries, the color being that of the LED
+ * strips of the hoops scoring for the team. Team numbers are the ids' enum values, which
+ * the game (myprogram.c) keeps scores by and records in the event trace, and which
+ * host/evdecode turns back into the names.
+ */
+#ifndef _TEAMS_H
+#define _TEAMS_H
+
+#define TEAM_LIST \
+    TEAM(RED, "red", 0xFF, 0x00, 0x00) \
+    TEAM(BLUE, "blue", 0x00, 0x00, 0xFF)
+
+#define TEAM(id, name, red, green, blue) id,
+enum { TEAM_LIST NUM_TEAMS };
+#undef TEAM
+
+#endif
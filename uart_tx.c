@@ -0,0 +1,93 @@
+/* File: uart_tx.c
+ * -------------
+ * Transmit ring buffer for the console uart, see uart_tx.h.
+ */
+
+#include "uart_tx.h"
+#include "hal.h"
+#include "interrupts.h"
+#include "irq_stats.h"
+#include "printf.h"
+#include "strings.h"
+#include "uart.h"
+#include <stdarg.h>
+
+#define MASK (UART_TX_BUF_LEN - 1)
+
+static struct {
+    uint8_t buf[UART_TX_BUF_LEN];
+    volatile unsigned int head, tail; // tail written by writers, head by the handler
+    bool initialized;
+} tx;
+
+// Moves queued bytes into the hardware FIFO while it has room, and stops the interrupt
+// once the ring is empty. Called with interrupts masked.
+static void fill_fifo(void) {
+    unsigned int head = tx.head;
+    while (head != tx.tail && hal_uart_tx_ready()) {
+        hal_uart_tx_put(tx.buf[head++ & MASK]);
+    }
+    tx.head = head;
+    if (head == tx.tail) hal_uart_tx_irq(false);
+}
+
+static void handle_tx(void *aux_data) {
+    hal_uart_irq_ack();
+    fill_fifo();
+}
+
+void uart_tx_init(void) {
+    tx.head = tx.tail = 0;
+    irq_stats_register_handler(INTERRUPT_SOURCE_UART0, handle_tx, NULL, "uart tx");
+    interrupts_enable_source(INTERRUPT_SOURCE_UART0);
+    tx.initialized = true;
+}
+
+void uart_tx_write(const void *data, int len) {
+    const uint8_t *p = data;
+    if (!tx.initialized) {
+        for (int i = 0; i < len; i++) uart_putchar(p[i]);
+        return;
+    }
+    while (len > 0) {
+        unsigned long irq = hal_irq_save();
+        unsigned int tail = tx.tail;
+        int room = UART_TX_BUF_LEN - (tail - tx.head);
+        int n = len < room ? len : room;
+        for (int i = 0; i < n; i++) {
+            tx.buf[(tail + i) & MASK] = p[i];
+        }
+        tx.tail = tail + n;
+        if (n) hal_uart_tx_irq(true); // fires straight away if the FIFO has room
+        else if (!irq) fill_fifo();   // full and nobody else will drain it
+        hal_irq_restore(irq);
+        p += n;
+        len -= n;
+    }
+}
+
+void uart_tx_putstring(const char *str) {
+    uart_tx_write(str, strlen(str));
+}
+
+int uart_tx_printf(const char *format, ...) {
+    char line[UART_TX_LINE_MAX];
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(line, sizeof(line), format, ap);
+    va_end(ap);
+    uart_tx_write(line, n < (int)sizeof(line) ? n : (int)sizeof(line) - 1);
+    return n;
+}
+
+void uart_tx_flush(void) {
+    if (!tx.initialized) return;
+    while (true) {
+        unsigned long irq = hal_irq_save();
+        if (!irq) fill_fifo();
+        bool empty = tx.head == tx.tail;
+        hal_irq_restore(irq);
+        if (empty) break;
+    }
+    while (!hal_uart_tx_idle()) {}
+}
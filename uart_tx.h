@@ -0,0 +1,32 @@
+/* File: uart_tx.h
+ * -------------
+ * Interrupt-driven console output. Writes copy into a ring buffer and return; the uart's
+ * transmit-empty interrupt moves the bytes into the hardware FIFO as it drains, so the
+ * game loop never waits on the 115200 baud line the way printf does.
+ *
+ * When the ring is full the writer waits for room: with interrupts enabled the handler
+ * makes it, with them masked (inside a handler or a critical section) the writer feeds
+ * the FIFO itself. Before uart_tx_init every write goes straight to the blocking uart
+ * library.
+ */
+#ifndef _UART_TX_H
+#define _UART_TX_H
+
+#include <stdbool.h>
+
+#define UART_TX_BUF_LEN 4096 // bytes, power of two
+#define UART_TX_LINE_MAX 256 // longest uart_tx_printf output, longer is cut off
+
+void uart_tx_init(void);
+
+void uart_tx_write(const void *data, int len);
+
+void uart_tx_putstring(const char *str);
+
+int uart_tx_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// Waits until every queued byte has left the uart, before anything that stops the
+// interrupts or falls back to printf
+void uart_tx_flush(void);
+
+#endif